@@ -0,0 +1,137 @@
+//
+// Counts heap allocations on the command path: parse a request, execute it
+// and build the reply, the way a session does with its reused buffers.
+//
+// Usage: bench_allocations [iterations]   (default: 100000)
+// Exits non-zero if a read allocates, so it doubles as a regression test.
+//
+
+#include "command_handler.h"
+#include "command_parser.h"
+#include "database.h"
+#include "reply.h"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace {
+
+    std::atomic<std::size_t> allocations{0};
+
+}
+
+void *operator new(std::size_t size) {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void *pointer = std::malloc(size == 0 ? 1 : size)) {
+        return pointer;
+    }
+    throw std::bad_alloc();
+}
+
+void *operator new[](std::size_t size) {
+    return operator new(size);
+}
+
+void operator delete(void *pointer) noexcept {
+    std::free(pointer);
+}
+
+void operator delete[](void *pointer) noexcept {
+    std::free(pointer);
+}
+
+void operator delete(void *pointer, std::size_t) noexcept {
+    std::free(pointer);
+}
+
+void operator delete[](void *pointer, std::size_t) noexcept {
+    std::free(pointer);
+}
+
+namespace {
+
+    using Clock = std::chrono::steady_clock;
+
+    struct Result {
+        double allocations_per_op;
+        double ns_per_op;
+    };
+
+    // Runs `request` repeatedly through the parser and handler, reusing the
+    // token and reply buffers like Session does
+    Result run(Database &db, std::string_view request, std::size_t iterations) {
+        std::vector<std::string_view> tokens;
+        std::string response;
+        // Warm up so buffers reach their steady-state capacity
+        for (int i = 0; i < 16; i++) {
+            parseCommand(request, tokens);
+            response.clear();
+            ReplyBuilder reply(response, Protocol::Resp);
+            handleCommand(tokens, db, reply);
+        }
+
+        std::size_t before = allocations.load();
+        auto start = Clock::now();
+        for (std::size_t i = 0; i < iterations; i++) {
+            parseCommand(request, tokens);
+            response.clear();
+            ReplyBuilder reply(response, Protocol::Resp);
+            handleCommand(tokens, db, reply);
+        }
+        double elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+        return {static_cast<double>(allocations.load() - before) / iterations, elapsed * 1e9 / iterations};
+    }
+
+}
+
+int main(int argc, char *argv[]) {
+    std::size_t iterations = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 100000;
+    if (iterations == 0) {
+        iterations = 1;
+    }
+
+    Database db;
+    db.set("user:1000:profile", std::string(256, 'x'));
+    db.set("counter", "12");
+    for (int i = 0; i < 100; i++) {
+        std::string element = "element:" + std::to_string(i);
+        db.rpush("list", {element});
+        db.hset("hash", element, "value");
+        db.sadd("set", {element});
+    }
+
+    struct Case {
+        const char *name;
+        std::string_view request;
+        bool allocation_free; // reads must not allocate
+    };
+    const std::string set_100 = "*3\r\n$3\r\nSET\r\n$24\r\nsession:0123456789abcdef\r\n$100\r\n" +
+                                std::string(100, 'v') + "\r\n";
+    const Case cases[] = {
+        {"GET hit", "*2\r\n$3\r\nGET\r\n$17\r\nuser:1000:profile\r\n", true},
+        {"GET hit (inline)", "get user:1000:profile\r\n", true},
+        {"GET miss", "*2\r\n$3\r\nGET\r\n$7\r\nmissing\r\n", true},
+        {"LRANGE 100", "*4\r\n$6\r\nLRANGE\r\n$4\r\nlist\r\n$1\r\n0\r\n$2\r\n-1\r\n", true},
+        {"HGETALL 100", "*2\r\n$7\r\nHGETALL\r\n$4\r\nhash\r\n", true},
+        {"SMEMBERS 100", "*2\r\n$8\r\nSMEMBERS\r\n$3\r\nset\r\n", true},
+        {"SET overwrite", "*3\r\n$3\r\nSET\r\n$7\r\ncounter\r\n$2\r\n13\r\n", false},
+        // Keyspace strings come from the slab's thread cache, not the heap
+        {"SET 100-byte value", set_100, true},
+    };
+
+    bool ok = true;
+    for (const Case &test : cases) {
+        Result result = run(db, test.request, iterations);
+        std::printf("%-20s %8.3f allocations/op  %7.1f ns/op\n", test.name, result.allocations_per_op,
+                    result.ns_per_op);
+        if (test.allocation_free && result.allocations_per_op > 0) {
+            ok = false;
+        }
+    }
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,88 @@
+//
+// Microbenchmark: keyspace dictionary (FlatHashMap) vs std::unordered_map.
+//
+// Usage: bench_dictionary [key_count ...]   (default: 1000000)
+// e.g.   bench_dictionary 1000000 100000000
+// The 100M run needs roughly 20GB of memory for both maps' keys and values.
+//
+
+#include "flat_hash_map.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+
+    using Clock = std::chrono::steady_clock;
+
+    double seconds_since(Clock::time_point start) {
+        return std::chrono::duration<double>(Clock::now() - start).count();
+    }
+
+    void format_key(char *buffer, std::size_t i) {
+        std::snprintf(buffer, 32, "key:%zu", i);
+    }
+
+    template <typename Map>
+    void run(const char *name, std::size_t count) {
+        Map map;
+        char key[32];
+
+        auto start = Clock::now();
+        for (std::size_t i = 0; i < count; i++) {
+            format_key(key, i);
+            map.try_emplace(key, "value");
+        }
+        double insert = seconds_since(start);
+
+        // Lookups in a scattered order so neither map benefits from insertion order
+        std::size_t hits = 0;
+        start = Clock::now();
+        for (std::size_t i = 0; i < count; i++) {
+            format_key(key, (i * 2654435761u) % count);
+            hits += map.find(std::string_view(key)) != map.end();
+        }
+        double hit = seconds_since(start);
+
+        std::size_t misses = 0;
+        start = Clock::now();
+        for (std::size_t i = 0; i < count; i++) {
+            format_key(key, count + i);
+            misses += map.find(std::string_view(key)) == map.end();
+        }
+        double miss = seconds_since(start);
+
+        std::printf("%-20s %12zu keys  insert %7.1f ns/op  hit %7.1f ns/op  miss %7.1f ns/op  (%zu/%zu)\n",
+                    name, count, insert * 1e9 / count, hit * 1e9 / count, miss * 1e9 / count, hits, misses);
+    }
+
+    // std::unordered_map needs a transparent hash for string_view lookups in
+    // C++20 only; look it up through a string like the old keyspace did.
+    struct StdMap {
+        std::unordered_map<std::string, std::string> map;
+
+        void try_emplace(const char *key, const char *value) { map.try_emplace(key, value); }
+        auto find(std::string_view key) { return map.find(std::string(key)); }
+        auto end() { return map.end(); }
+    };
+
+}
+
+int main(int argc, char *argv[]) {
+    std::vector<std::size_t> counts;
+    for (int i = 1; i < argc; i++) {
+        counts.push_back(std::strtoull(argv[i], nullptr, 10));
+    }
+    if (counts.empty()) {
+        counts.push_back(1000000);
+    }
+
+    for (std::size_t count : counts) {
+        run<FlatHashMap<std::string>>("FlatHashMap", count);
+        run<StdMap>("std::unordered_map", count);
+    }
+    return 0;
+}
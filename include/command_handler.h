@@ -6,13 +6,75 @@
 #define COMMAND_HANDLER_H
 
 #include <string>
+#include <string_view>
 #include <vector>
 #include "database.h"
+#include "reply.h"
 
-std::string handleCommand(const std::vector<std::string>& tokens, Database& db);
+// A command's tokens. They view the connection's input, except that a large
+// last argument may have been received into a string of its own (see
+// Session); take() hands that string over instead of copying it.
+class CommandArgs {
+public:
+    CommandArgs(const std::vector<std::string_view>& tokens, std::string* payload = nullptr)
+        : tokens_(tokens), payload_(payload) {}
 
-std::string to_upper(const std::string& input);
+    std::size_t size() const { return tokens_.size(); }
+    bool empty() const { return tokens_.empty(); }
+    const std::string_view& operator[](std::size_t index) const { return tokens_[index]; }
+    std::vector<std::string_view>::const_iterator begin() const { return tokens_.begin(); }
+    std::vector<std::string_view>::const_iterator end() const { return tokens_.end(); }
 
-bool try_parse_int(const std::string& str, int& value);
+    // Token `index` as an owned string. The payload is moved out, after
+    // which its token must not be used again.
+    std::string take(std::size_t index) const;
+
+private:
+    const std::vector<std::string_view>& tokens_;
+    std::string* payload_;
+};
+
+using CommandHandler = void (*)(const CommandArgs& tokens, Database& db, ReplyBuilder& reply);
+
+enum CommandFlags : unsigned {
+    command_write = 1u << 0,      // may modify the keyspace
+    command_readonly = 1u << 1,   // only reads the keyspace
+    command_denyoom = 1u << 2,    // may grow memory; refused while over maxmemory
+    command_all_shards = 1u << 3, // runs on every shard, e.g. FLUSHALL
+};
+
+// Static description of a command, looked up by name in O(1)
+struct CommandSpec {
+    std::string_view name;  // upper case
+    CommandHandler handler;
+    // Like Redis: N means exactly N tokens including the name, -N at least N
+    int arity;
+    unsigned flags;
+    // Key positions as token indexes; last_key < 0 counts from the end
+    // (-1 is the last token). first_key 0 means the command takes no keys.
+    int first_key;
+    int last_key;
+    int key_step;
+    const char* usage;      // error reply when the arity does not match
+
+    bool has(CommandFlags flag) const { return (flags & flag) != 0; }
+    bool arity_ok(std::size_t count) const {
+        return arity >= 0 ? count == static_cast<std::size_t>(arity) : count >= static_cast<std::size_t>(-arity);
+    }
+};
+
+// Case-insensitive; nullptr for unknown commands
+const CommandSpec* find_command(std::string_view name);
+
+// `tokens` may point straight into the connection's read buffer; nothing is
+// copied unless it ends up stored in the database.
+void handleCommand(const CommandArgs& tokens, Database& db, ReplyBuilder& reply);
+void handleCommand(const std::vector<std::string_view>& tokens, Database& db, ReplyBuilder& reply);
+
+bool equals_ignore_case(std::string_view a, std::string_view b);
+
+bool try_parse_int(std::string_view str, int& value);
+
+bool try_parse_long_long(std::string_view str, long long& value);
 
 #endif //COMMAND_HANDLER_H
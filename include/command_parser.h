@@ -5,9 +5,72 @@
 #ifndef COMMAND_PARSER_H
 #define COMMAND_PARSER_H
 
-#include <string>
+#include <cstddef>
+#include <string_view>
+#include <utility>
 #include <vector>
 
-std::vector<std::string> parseCommand(const std::string& input);
+// Wire format a request arrived in. Replies are written back in the same one.
+enum class Protocol {
+    Inline, // whitespace separated line, e.g. typed through telnet
+    Resp    // RESP multibulk: *<n>\r\n followed by n $<len>\r\n<bytes>\r\n
+};
+
+enum class ParseStatus {
+    Complete,   // one full command was parsed
+    Incomplete, // more bytes are needed, nothing was consumed
+    Error       // the input can never become a valid command
+};
+
+struct ParseResult {
+    ParseStatus status = ParseStatus::Incomplete;
+    Protocol protocol = Protocol::Inline;
+    std::size_t consumed = 0;     // bytes making up the command when Complete
+    std::string_view error;       // static message when status is Error
+    // Incomplete RESP requests only: once the header of a bulk argument has
+    // arrived, where that argument's bytes start in `input` and how many
+    // there are, and whether it is the request's last argument
+    std::size_t pending_bulk_offset = 0;
+    std::size_t pending_bulk_length = 0;
+    bool pending_bulk_last = false;
+};
+
+// How far an unfinished request has been parsed, so the next call on it
+// resumes there instead of scanning the request from its first byte again.
+// Offsets count from the start of the request, so they stay valid when the
+// caller moves its buffer. Cleared once a call returns Complete or Error.
+struct ParseState {
+    std::size_t pos = 0;   // inline: bytes searched for the newline; RESP: next argument's header, 0 before the count
+    long long count = 0;   // arguments announced by the RESP header
+    std::vector<std::pair<std::size_t, std::size_t>> arguments; // offset and length of each argument parsed so far
+};
+
+// Limits mirroring the ones real Redis enforces on untrusted clients.
+constexpr std::size_t max_inline_length = 64 * 1024;
+constexpr long long max_multibulk_length = 1024 * 1024;
+constexpr long long max_bulk_length = 512LL * 1024 * 1024;
+
+// Parses a single command from the front of `input`.
+// RESP requests are detected by a leading '*'; anything else is treated as an
+// inline command. A request split across several reads is resumed from
+// `state`, which the caller keeps alongside its buffer; each call must see the
+// same request at the front of `input`, with more bytes behind it.
+// On Complete, `tokens` holds views into `input` (it is cleared first and its
+// capacity reused, so no per-token allocation happens). An empty line yields
+// Complete with no tokens.
+ParseResult parseCommand(std::string_view input, std::vector<std::string_view>& tokens, ParseState& state);
+// Without a state: a request that has not fully arrived is parsed from the start
+ParseResult parseCommand(std::string_view input, std::vector<std::string_view>& tokens);
+
+// Parses a RESP request whose last bulk argument was received into separate
+// storage. `input` holds the request with that argument's bytes left out:
+// the first `head` bytes (pending_bulk_offset of an Incomplete parseCommand)
+// followed by the argument's terminating CRLF. `last` becomes the final
+// token; `consumed` covers the head and the CRLF. `state` may come from the
+// parseCommand calls that found the argument.
+ParseResult parseCommandWithLast(std::string_view input, std::size_t head, std::string_view last,
+                                 std::vector<std::string_view>& tokens, ParseState& state);
+ParseResult parseCommandWithLast(std::string_view input, std::size_t head, std::string_view last,
+                                 std::vector<std::string_view>& tokens);
 
 #endif //COMMAND_PARSER_H
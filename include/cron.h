@@ -0,0 +1,37 @@
+//
+// Periodic housekeeping run on an event loop, in the spirit of Redis' serverCron.
+//
+
+#ifndef CRON_H
+#define CRON_H
+
+#include <chrono>
+#include <boost/asio.hpp>
+#include "database.h"
+
+class Cron {
+public:
+    // Ticks on `io_context` for as long as the object lives
+    Cron(boost::asio::io_context& io_context, Database& db);
+
+private:
+    void schedule();
+    void tick();
+
+    static constexpr std::chrono::milliseconds interval{100};
+    // Per tick, at most 1ms goes to finishing table migrations
+    static constexpr std::chrono::microseconds rehash_budget{1000};
+    // Active expiry gets up to 25% of the loop's time on regular ticks. When a
+    // cycle runs out of budget with expired keys still piling up, extra short
+    // cycles run every fast_interval until the backlog clears.
+    static constexpr std::chrono::microseconds expire_budget{25000};
+    static constexpr std::chrono::milliseconds fast_interval{10};
+    static constexpr std::chrono::microseconds fast_expire_budget{1000};
+
+    boost::asio::steady_timer timer_;
+    Database& db_;
+    std::chrono::steady_clock::time_point last_tick_;
+    bool expire_backlog_ = false;
+};
+
+#endif //CRON_H
@@ -5,76 +5,376 @@
 #ifndef DATABASE_H
 #define DATABASE_H
 
+#include <atomic>
+#include <cstdint>
 #include <string>
+#include <string_view>
 #include <unordered_map>
 #include <vector>
 #include <set>
 #include <map>
 #include <mutex>
+#include <shared_mutex>
 #include <chrono>
+#include <memory>
+#include <random>
+#include "encoding_limits.h"
+#include "flat_hash_map.h"
+#include "hash_object.h"
+#include "quicklist.h"
+#include "reply.h"
+#include "set_object.h"
+#include "shared_buffer.h"
+#include "timer_wheel.h"
+#include "zset_object.h"
 
-enum class DataType {
+enum class DataType : std::uint8_t {
     STRING,
     LIST,
     HASH,
-    SET
+    SET,
+    ZSET
 };
 
-struct Value {
-    DataType type;
-    std::string string_val;
-    std::vector<std::string> list_val;
-    std::unordered_map<std::string ,std::string> hash_val;
-    std::set<std::string> set_val;
-    std::chrono::steady_clock::time_point expiry;
-    bool has_expiry = false;
+using List = QuickList;
+using Hash = HashObject;
+using Set = SetObject;
+using ZSet = ZSetObject;
+
+// Which keys maxmemory eviction may pick, and how it ranks them
+enum class EvictionPolicy {
+    NoEviction,  // refuse writes that need memory instead
+    AllKeysLru,  // least recently used key
+    AllKeysLfu,  // least frequently used key
+    VolatileLru, // least recently used key with a TTL
+    VolatileTtl  // key with a TTL closest to its deadline
+};
+
+// A key's value holds only the encoding its type needs. Strings are stored
+// inline; containers live behind a pointer so the common small-string key
+// pays for one SlabString plus a type tag. Expiry is kept out of line in
+// the owning stripe, so keys without a TTL pay nothing for it. The tag and
+// the eviction metadata share the padding after the string.
+// Strings of shared_string_min bytes or more are kept in a SharedBuffer
+// instead, so a reply can hold on to them after the stripe lock is released.
+class Value {
+public:
+    static constexpr std::size_t shared_string_min = 16 * 1024;
+
+    Value() : Value(std::string_view()) {}
+    // Copies the bytes, into a SharedBuffer from shared_string_min on
+    explicit Value(std::string_view str);
+    explicit Value(SharedBuffer blob);
+    // An empty value of the given type
+    explicit Value(DataType type);
+    Value(Value &&other) noexcept;
+    Value &operator=(Value &&other) noexcept;
+    Value(const Value &) = delete;
+    Value &operator=(const Value &) = delete;
+    ~Value() { reset(); }
+
+    DataType type() const { return type_; }
+
+    // Strings are immutable in place; SET replaces the whole value
+    std::string_view string_val() const { return shared_ ? blob_.view() : std::string_view(str_); }
+    // True if the string is held in a SharedBuffer
+    bool is_shared_string() const { return type_ == DataType::STRING && shared_; }
+    // Another handle to the string's buffer; only for is_shared_string() values
+    SharedBuffer shared_string() const { return blob_; }
+    // False for a short string kept inside the std::string object itself
+    bool string_on_heap() const;
+    List &list_val() { return *list_; }
+    const List &list_val() const { return *list_; }
+    Hash &hash_val() { return *hash_; }
+    const Hash &hash_val() const { return *hash_; }
+    Set &set_val() { return *set_; }
+    const Set &set_val() const { return *set_; }
+    ZSet &zset_val() { return *zset_; }
+    const ZSet &zset_val() const { return *zset_; }
+
+    // Approximate heap bytes the value owns beyond the Value itself
+    std::size_t memory_usage() const;
+    // Roughly how many allocations destroying the value frees
+    std::size_t free_effort() const;
+
+    // LRU clock or LFU counter, depending on the eviction policy. Readers
+    // update it while sharing the stripe lock, hence the relaxed atomic.
+    std::uint32_t access() const { return access_.load(std::memory_order_relaxed); }
+    void set_access(std::uint32_t access) const { access_.store(access, std::memory_order_relaxed); }
+
+private:
+    // Destroys the active member
+    void reset();
+    // Moves other's member into this object's (destroyed) storage
+    void take(Value &other);
+
+    union {
+        SlabString str_;
+        SharedBuffer blob_;
+        List *list_;
+        Hash *hash_;
+        Set *set_;
+        ZSet *zset_;
+    };
+    DataType type_;
+    bool shared_ = false; // a STRING held in blob_ rather than str_
+    mutable std::atomic<std::uint32_t> access_{0};
 };
 
 class Database {
 public:
+    // An unsynchronized database skips all locking. It must only ever be used
+    // from one thread, e.g. as the private partition of a shard.
+    explicit Database(bool synchronized = true);
+
+    // Thresholds for the compact hash and set encodings. Only affects values
+    // created or grown afterwards; set it before serving traffic.
+    void set_encoding_limits(const EncodingLimits &limits) { encoding_limits = limits; }
+    // Caps the keyspace at `bytes` (0 for no limit). Commands that grow the
+    // data call free_memory_if_needed() first, which evicts keys chosen by
+    // `policy` from `samples` random keys per round. Set before serving.
+    void set_maxmemory(std::size_t bytes, EvictionPolicy policy, std::size_t samples = 5);
+    std::size_t maxmemory_limit() const { return maxmemory; }
+    EvictionPolicy maxmemory_policy() const { return eviction_policy; }
+    // Parses a maxmemory-policy name such as "allkeys-lru"
+    static bool parse_eviction_policy(std::string_view name, EvictionPolicy &policy);
+    static const char *eviction_policy_name(EvictionPolicy policy);
+
+    // The overloads taking a ReplyBuilder serialize their result straight
+    // from the stored value while the stripe lock is held, instead of copying
+    // it out first. A missing key (or one of another type) gets a null or an
+    // empty array, as Redis replies. The value-returning forms use "NULL".
+
     // String operations
-    void set(const std::string &key, const std::string &value);
-    std::string get(const std::string &key);
-    bool del(const std::string &key);
+    // Short values are copied into the slab. A large value can come as a
+    // SharedBuffer, so a payload that was just received is stored as is.
+    void set(std::string_view key, std::string_view value);
+    void set(std::string_view key, SharedBuffer value);
+    std::string get(std::string_view key);
+    void get(std::string_view key, ReplyBuilder &reply);
+    bool del(std::string_view key);
+    long long del(const std::vector<std::string> &keys);
+    // Removes every key. With `async` the old tables are destroyed on the
+    // lazy-free thread, so the call returns once they are detached.
+    void flushall(bool async);
 
     // List operations
-
-    long long lpush(const std::string &key, const std::vector<std::string> &values);
-    long long rpush(const std::string &key, const std::vector<std::string> &values);
-    std::string lpop(const std::string &key);
-    std::string rpop(const std::string &key);
-    std::vector<std::string> lrange(const std::string &key, int start, int end);
+    long long lpush(std::string_view key, const std::vector<std::string> &values);
+    long long rpush(std::string_view key, const std::vector<std::string> &values);
+    std::string lpop(std::string_view key);
+    std::string rpop(std::string_view key);
+    void lpop(std::string_view key, ReplyBuilder &reply);
+    void rpop(std::string_view key, ReplyBuilder &reply);
+    std::vector<std::string> lrange(std::string_view key, int start, int end);
+    void lrange(std::string_view key, int start, int end, ReplyBuilder &reply);
 
     // Hash operations
-    bool hset(const std::string &key, const std::string &field, const std::string &value);
-    std::string hget(const std::string &key, const std::string &field);
-    bool hdel(const std::string &key, const std::string &field);
-    std::unordered_map<std::string, std::string> hgetall(const std::string &key);
+    bool hset(std::string_view key, std::string_view field, std::string_view value);
+    // Sets every field/value pair atomically, returning how many fields are new
+    long long hset(std::string_view key, const std::vector<std::pair<std::string, std::string>> &pairs);
+    std::string hget(std::string_view key, std::string_view field);
+    void hget(std::string_view key, std::string_view field, ReplyBuilder &reply);
+    // One value per field, "NULL" for missing fields
+    std::vector<std::string> hmget(std::string_view key, const std::vector<std::string> &fields);
+    void hmget(std::string_view key, const std::vector<std::string_view> &fields, ReplyBuilder &reply);
+    bool hdel(std::string_view key, std::string_view field);
+    long long hdel(std::string_view key, const std::vector<std::string> &fields);
+    std::unordered_map<std::string, std::string> hgetall(std::string_view key);
+    // Fields and values alternate, in the hash's storage order
+    void hgetall(std::string_view key, ReplyBuilder &reply);
+    // Adds `increment` to an integer field (missing fields count as 0). Fails,
+    // leaving the hash untouched, if the field is not an integer, the result
+    // would overflow, or the key holds another type.
+    bool hincrby(std::string_view key, std::string_view field, long long increment, long long &result);
 
     // Set operations
-    long long sadd(const std::string &key, const std::set<std::string> &members);
-    long long srem(const std::string &key, const std::set<std::string> &members);
-    bool sismember(const std::string &key, const std::string &member);
-    std::set<std::string> smembers(const std::string &key);
+    long long sadd(std::string_view key, const std::set<std::string> &members);
+    long long srem(std::string_view key, const std::set<std::string> &members);
+    bool sismember(std::string_view key, std::string_view member);
+    std::set<std::string> smembers(std::string_view key);
+    // Members in the set's storage order
+    void smembers(std::string_view key, ReplyBuilder &reply);
+    long long scard(std::string_view key);
+
+    // Sorted set operations
+    // Adds or updates (score, member) pairs, returning how many members are new
+    long long zadd(std::string_view key, const std::vector<std::pair<double, std::string>> &entries);
+    long long zrem(std::string_view key, const std::vector<std::string> &members);
+    bool zscore(std::string_view key, std::string_view member, double &score);
+    bool zrank(std::string_view key, std::string_view member, long long &rank);
+    long long zcard(std::string_view key);
+    // The range commands write their reply array straight from the zset while
+    // holding the lock, instead of copying the range out first. Ranks count
+    // from 0, negative ones from the end; scores follow members if requested.
+    void zrange(std::string_view key, long long start, long long stop, bool with_scores, ReplyBuilder &reply);
+    // `count` < 0 means no limit
+    void zrangebyscore(std::string_view key, const ScoreRange &range, bool with_scores,
+                       long long offset, long long count, ReplyBuilder &reply);
 
     // Key operations
-    bool exists(const std::string &key);
-    bool expire(const std::string &key, int seconds);
-    long long ttl(const std::string &key);
+    bool exists(std::string_view key);
+    long long exists(const std::vector<std::string> &keys);
+    // A TTL of zero or less, or a past deadline, deletes the key. A deadline
+    // the clock cannot represent leaves it alone and returns false.
+    bool expire(std::string_view key, int seconds);
+    bool pexpire(std::string_view key, long long milliseconds);
+    // Deadline as a Unix time in milliseconds
+    bool pexpireat(std::string_view key, long long unix_milliseconds);
+    // Whether pexpire / pexpireat can represent the deadline right now
+    static bool ttl_fits(long long milliseconds);
+    static bool unix_deadline_fits(long long unix_milliseconds);
+    // Remaining time to live, -1 without a TTL, -2 if the key does not exist
+    long long ttl(std::string_view key);
+    long long pttl(std::string_view key);
 
     // Utility methods
-    DataType type(const std::string &key);
-    void cleanup_expired_keys();
+    DataType type(std::string_view key);
+    // Name of the encoding backing `key` (as OBJECT ENCODING reports it), or
+    // an empty string if the key does not exist
+    std::string object_encoding(std::string_view key);
+    // Number of keys, including expired ones not yet reaped
+    std::size_t dbsize();
+    // Bytes held by the keyspace: table slots, keys, values and TTL entries
+    std::size_t used_memory() const;
+    // Evicts keys until used memory is within maxmemory. Returns false if
+    // that is not possible: the policy is noeviction or nothing is evictable.
+    bool free_memory_if_needed();
+    // Refreshes the clock access metadata is stamped with. The cron calls
+    // it every tick, so LRU idle times have roughly 100ms resolution.
+    void update_clock();
+    // Active expiry: advances each stripe's timer wheel to now, deleting the
+    // keys whose deadlines it reaches. Stops once `budget` is spent and
+    // returns true if it did so with due keys left over.
+    bool cleanup_expired_keys(std::chrono::microseconds budget);
+    // Spends up to `budget` moving entries of growing stripe tables into their
+    // new tables, so migrations finish during idle time rather than on writes.
+    // Returns true if any stripe still has work left.
+    bool incremental_rehash(std::chrono::microseconds budget);
 
 private:
-    std::unordered_map<std::string, Value> data;
-    std::mutex mutex;
+    // The keyspace is split into independently locked stripes chosen by key
+    // hash, so operations on different keys rarely contend on the same mutex.
+    // Read-only commands share a stripe, writers take it exclusively.
+    // Each stripe sits on its own cache line to avoid false sharing.
+    struct alignas(64) Stripe {
+        FlatHashMap<Value> data;
+        // Deadlines of the keys in `data` that have a TTL
+        FlatHashMap<std::chrono::steady_clock::time_point> expires;
+        // The same deadlines ordered in time, created with the first TTL.
+        // `expires` stays authoritative; stale wheel entries are skipped.
+        std::unique_ptr<TimerWheel> wheel;
+        // The tick of each key's live wheel entry. A later deadline reuses
+        // it: the entry moves on when it fires. Entries filed under another
+        // tick are stale.
+        FlatHashMap<std::uint64_t> scheduled;
+        // Heap bytes behind the entries of `data`, `expires` and `scheduled`
+        std::size_t payload = 0;
+        // payload plus the tables' slot arrays and the wheel, refreshed after
+        // every write so used_memory() can sum the stripes without taking
+        // their locks
+        std::atomic<std::size_t> used_memory{0};
+        std::shared_mutex mutex;
+    };
+    // A sampled key and how good a victim it is (higher evicts first)
+    struct EvictionCandidate {
+        std::uint64_t score;
+        std::string key;
+    };
+    static constexpr std::size_t stripe_bits = 6;
+    static constexpr std::size_t stripe_count = std::size_t(1) << stripe_bits;
+    // Expired keys deleted between checks of the active expiry budget
+    static constexpr std::size_t expire_batch = 32;
+    // Values whose destruction frees more allocations than this are handed
+    // to the lazy-free thread when deleted, overwritten, expired or evicted
+    static constexpr std::size_t lazyfree_threshold = 64;
+    // Best candidates kept between eviction rounds
+    static constexpr std::size_t eviction_pool_size = 16;
+    // LFU counters start here so new keys are not evicted straight away, and
+    // grow logarithmically: each hit increments with probability
+    // 1 / ((counter - lfu_init) * lfu_log_factor + 1). They decay by one per
+    // idle minute.
+    static constexpr std::uint32_t lfu_init = 5;
+    static constexpr std::uint32_t lfu_log_factor = 10;
+
+    using WriteLock = std::unique_lock<std::shared_mutex>;
+    using ReadLock = std::shared_lock<std::shared_mutex>;
+
+    std::unique_ptr<Stripe[]> stripes;
+    bool synchronized;
+    EncodingLimits encoding_limits;
+    // First stripe the next active expiry cycle looks at. Only the cron
+    // that owns this database runs cycles, one at a time.
+    std::size_t expire_stripe_cursor = 0;
+
+    std::size_t maxmemory = 0;
+    EvictionPolicy eviction_policy = EvictionPolicy::NoEviction;
+    std::size_t eviction_samples = 5;
+    // Milliseconds on the steady clock, truncated; differences wrap correctly
+    std::atomic<std::uint32_t> clock_ms{0};
+    // Sorted by ascending score, guarded by eviction_mutex
+    std::vector<EvictionCandidate> eviction_pool;
+    std::minstd_rand eviction_rng;
+    std::mutex eviction_mutex;
+
+    Stripe &stripe_for(std::string_view key);
+    // Take a stripe's lock, or a no-op lock for an unsynchronized database
+    WriteLock lock_stripe(Stripe &stripe);
+    ReadLock lock_stripe_shared(Stripe &stripe);
+    // Stripes touched by `keys`, deduplicated and in ascending order. Locking
+    // them in this order means two multi-key operations can never wait on
+    // each other in a cycle.
+    std::vector<Stripe *> stripes_for(const std::vector<std::string> &keys);
+
     // helper function to check if a key exists or correct type
-    bool check_or_create_type(const std::string &key, DataType type);
+    bool check_or_create_type(Stripe &stripe, std::string_view key, DataType type);
     // helper function to check if a key is of the correct type
-    bool check_type(const std::string &key, DataType type);
-    // helper function to check if a key expired
-    bool is_expired(const std::string &key);
+    bool check_type(Stripe &stripe, std::string_view key, DataType type);
+    // helper function to check if a key expired, removing it if so (needs the write lock)
+    bool is_expired(Stripe &stripe, std::string_view key);
+    // Removes a key together with its expiry entry
+    bool remove_key(Stripe &stripe, std::string_view key);
+    // Destroys a value being dropped from the keyspace, or hands it to the
+    // lazy-free thread if that would take long. Leaves `value` moved-from.
+    static void release(Value &value);
+    // Memory charged for one key: its heap-allocated name and value
+    static std::size_t entry_bytes(std::string_view key, const Value &value);
+    // Moves the stripe's payload from `released` to `added` bytes and
+    // republishes its usage (needs the write lock)
+    void account(Stripe &stripe, std::size_t released, std::size_t added);
+    // Access metadata for a new key, and the update for each access
+    void init_access(const Value &value) const;
+    void touch(const Value &value) const;
+    // LFU counter after applying the decay for idle minutes
+    std::uint32_t lfu_counter(std::uint32_t access) const;
+    // Adds sampled keys from random stripes to the eviction pool
+    void sample_eviction_pool();
+    // Deletes the best candidate still present; false if none was left
+    bool evict_one();
+    // Read-path lookup: the live entry for `key`, or nullptr. Never modifies
+    // the stripe; `expired` reports a dead entry that still needs reaping.
+    const Value *find_live(Stripe &stripe, std::string_view key, bool &expired);
+    // Calls read(const Value &) on the live entry for `key` under the shared
+    // lock. Returns false, reaping the entry if it expired, when there is none.
+    template <typename Read>
+    bool read_live(std::string_view key, Read &&read);
+    // Removes one end element of the list at `key`, first passing it to
+    // take(std::string_view) under the write lock; false if there is none
+    template <typename Take>
+    bool pop_element(std::string_view key, bool front, Take &&take);
+    // Timer wheel tick (millisecond) a point in time falls in
+    static std::uint64_t wheel_tick(std::chrono::steady_clock::time_point time);
+    // Sets the key's deadline in both expiry indexes (needs the write lock)
+    void set_deadline(Stripe &stripe, std::string_view key, std::chrono::steady_clock::time_point deadline);
+    // Shared body of both SETs
+    void set_value(std::string_view key, Value value);
+    // Shared body of the EXPIRE family
+    bool expire_in(std::string_view key, long long milliseconds);
+    bool expire_at(std::string_view key, std::chrono::steady_clock::time_point deadline);
+    // Remaining time to live in whole milliseconds, or -1 / -2
+    long long remaining_ttl(std::string_view key);
+    // Deletes `key` if it is still expired. Called after a reader saw it expire,
+    // so the write lock is only taken when there is something to remove.
+    void reap_expired(Stripe &stripe, std::string_view key);
 };
 
 #endif //DATABASE_H
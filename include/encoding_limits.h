@@ -0,0 +1,25 @@
+//
+// Size thresholds deciding when compact encodings convert to full ones.
+//
+
+#ifndef ENCODING_LIMITS_H
+#define ENCODING_LIMITS_H
+
+#include <cstddef>
+
+// A small hash, set or sorted set is kept as a listpack until it exceeds
+// either the entry count or the element length below, after which it
+// converts (once, permanently) to a hash table, or hash plus skiplist for
+// sorted sets. Sets of integers use an intset up to set_max_intset_entries
+// members instead. Defaults match Redis.
+struct EncodingLimits {
+    std::size_t hash_max_listpack_entries = 128;
+    std::size_t hash_max_listpack_value = 64;
+    std::size_t set_max_listpack_entries = 128;
+    std::size_t set_max_listpack_value = 64;
+    std::size_t set_max_intset_entries = 512;
+    std::size_t zset_max_listpack_entries = 128;
+    std::size_t zset_max_listpack_value = 64;
+};
+
+#endif //ENCODING_LIMITS_H
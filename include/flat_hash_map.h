@@ -0,0 +1,528 @@
+//
+// Open-addressing hash map with SIMD control-byte probing (Swiss-table style).
+//
+
+#ifndef FLAT_HASH_MAP_H
+#define FLAT_HASH_MAP_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include "slab_allocator.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define FLAT_HASH_MAP_SSE2 1
+#endif
+
+namespace flat_hash_detail {
+
+    // Every slot has a control byte: empty, deleted (tombstone), or the low
+    // 7 bits of the key's hash when full. Probing compares a whole group of 16
+    // control bytes against those 7 bits at once, so a lookup touches key
+    // memory only for likely matches.
+    using ctrl_t = std::int8_t;
+    constexpr ctrl_t ctrl_empty = -128;
+    constexpr ctrl_t ctrl_deleted = -2;
+    constexpr std::size_t group_width = 16;
+
+    inline bool is_full(ctrl_t c) { return c >= 0; }
+
+    inline unsigned lowest_bit(std::uint32_t mask) {
+#if defined(__GNUC__) || defined(__clang__)
+        return static_cast<unsigned>(__builtin_ctz(mask));
+#else
+        unsigned index = 0;
+        while ((mask & 1u) == 0) {
+            mask >>= 1;
+            ++index;
+        }
+        return index;
+#endif
+    }
+
+    // One group of control bytes; each match returns a bitmask of positions.
+    class Group {
+    public:
+        explicit Group(const ctrl_t *ctrl) {
+#ifdef FLAT_HASH_MAP_SSE2
+            bytes_ = _mm_loadu_si128(reinterpret_cast<const __m128i *>(ctrl));
+#else
+            for (std::size_t i = 0; i < group_width; ++i) {
+                bytes_[i] = ctrl[i];
+            }
+#endif
+        }
+
+        std::uint32_t match(ctrl_t h2) const {
+#ifdef FLAT_HASH_MAP_SSE2
+            return static_cast<std::uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_set1_epi8(h2), bytes_)));
+#else
+            return match_if([h2](ctrl_t c) { return c == h2; });
+#endif
+        }
+
+        std::uint32_t match_empty() const {
+#ifdef FLAT_HASH_MAP_SSE2
+            return match(ctrl_empty);
+#else
+            return match_if([](ctrl_t c) { return c == ctrl_empty; });
+#endif
+        }
+
+        std::uint32_t match_empty_or_deleted() const {
+#ifdef FLAT_HASH_MAP_SSE2
+            // Both special values are below -1, full slots are not
+            return static_cast<std::uint32_t>(_mm_movemask_epi8(_mm_cmpgt_epi8(_mm_set1_epi8(-1), bytes_)));
+#else
+            return match_if([](ctrl_t c) { return c < -1; });
+#endif
+        }
+
+    private:
+#ifdef FLAT_HASH_MAP_SSE2
+        __m128i bytes_;
+#else
+        template <typename Pred>
+        std::uint32_t match_if(Pred pred) const {
+            std::uint32_t mask = 0;
+            for (std::size_t i = 0; i < group_width; ++i) {
+                if (pred(bytes_[i])) {
+                    mask |= 1u << i;
+                }
+            }
+            return mask;
+        }
+
+        ctrl_t bytes_[group_width];
+#endif
+    };
+
+}
+
+// Map from string keys to V, looked up by std::string_view so callers never
+// need to materialize a key string just to search. Entries live in one flat
+// slot array (no per-node allocation); growth doubles the table once 7/8 of
+// the slots are used. Keys, slots and control bytes are slab allocated.
+//
+// Growing a large table never moves every entry at once. A new table is
+// allocated and the old one is drained into it incrementally: each insert or
+// erase migrates a group of slots, and idle time can drive rehash_step()
+// directly. Lookups consult both tables until the migration is done.
+// Pointers and iterators are invalidated by inserts and by erase(key), which
+// may migrate entries, but not by erase(iterator).
+template <typename V>
+class FlatHashMap {
+public:
+    using value_type = std::pair<SlabString, V>;
+
+    template <bool Const>
+    class Iterator {
+        using Map = std::conditional_t<Const, const FlatHashMap, FlatHashMap>;
+        using Slot = std::conditional_t<Const, const value_type, value_type>;
+
+    public:
+        Iterator() = default;
+        Iterator(Map *map, std::size_t index) : map_(map), index_(index) { skip_empty(); }
+        operator Iterator<true>() const { return Iterator<true>(map_, index_); }
+
+        Slot &operator*() const { return map_->slot_at(index_); }
+        Slot *operator->() const { return &map_->slot_at(index_); }
+        Iterator &operator++() {
+            ++index_;
+            skip_empty();
+            return *this;
+        }
+        bool operator==(const Iterator &other) const { return index_ == other.index_; }
+        bool operator!=(const Iterator &other) const { return index_ != other.index_; }
+
+    private:
+        friend class FlatHashMap;
+
+        void skip_empty() {
+            while (index_ < map_->slot_count() && !map_->full_at(index_)) {
+                ++index_;
+            }
+        }
+
+        Map *map_ = nullptr;
+        std::size_t index_ = 0; // old table's slots first, then the current table's
+    };
+
+    using iterator = Iterator<false>;
+    using const_iterator = Iterator<true>;
+
+    FlatHashMap() = default;
+    FlatHashMap(const FlatHashMap &) = delete;
+    FlatHashMap &operator=(const FlatHashMap &) = delete;
+
+    FlatHashMap(FlatHashMap &&other) noexcept { swap(other); }
+
+    FlatHashMap &operator=(FlatHashMap &&other) noexcept {
+        if (this != &other) {
+            FlatHashMap(std::move(other)).swap(*this);
+        }
+        return *this;
+    }
+
+    ~FlatHashMap() {
+        release(old_);
+        release(table_);
+    }
+
+    void swap(FlatHashMap &other) noexcept {
+        std::swap(table_, other.table_);
+        std::swap(old_, other.old_);
+        std::swap(migrate_pos_, other.migrate_pos_);
+        std::swap(size_, other.size_);
+    }
+
+    std::size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+    std::size_t capacity() const { return table_.capacity; }
+    bool rehashing() const { return old_.capacity != 0; }
+
+    iterator begin() { return iterator(this, 0); }
+    iterator end() { return iterator(this, slot_count()); }
+    const_iterator begin() const { return const_iterator(this, 0); }
+    const_iterator end() const { return const_iterator(this, slot_count()); }
+
+    iterator find(std::string_view key) { return iterator(this, locate(key, hash_of(key))); }
+    const_iterator find(std::string_view key) const { return const_iterator(this, locate(key, hash_of(key))); }
+    std::size_t count(std::string_view key) const { return locate(key, hash_of(key)) != slot_count() ? 1 : 0; }
+
+    // Inserts (key, V(args...)) unless the key is present. The key string is
+    // only built when an insert actually happens; an rvalue SlabString is
+    // moved in.
+    template <typename K, typename... Args>
+    std::pair<iterator, bool> try_emplace(K &&key, Args &&... args) {
+        return emplace_impl(std::forward<K>(key), std::forward<Args>(args)...);
+    }
+
+    template <typename K, typename... Args>
+    std::pair<iterator, bool> emplace(K &&key, Args &&... args) {
+        return emplace_impl(std::forward<K>(key), std::forward<Args>(args)...);
+    }
+
+    template <typename K, typename M>
+    std::pair<iterator, bool> insert_or_assign(K &&key, M &&value) {
+        auto result = emplace_impl(std::forward<K>(key), std::forward<M>(value));
+        if (!result.second) {
+            result.first->second = std::forward<M>(value);
+        }
+        return result;
+    }
+
+    V &operator[](std::string_view key) { return try_emplace(key).first->second; }
+
+    std::size_t erase(std::string_view key) {
+        rehash_step(migrate_groups_per_op);
+        std::size_t index = locate(key, hash_of(key));
+        if (index == slot_count()) {
+            return 0;
+        }
+        erase_at(index);
+        return 1;
+    }
+
+    // Erases the entry and returns an iterator to the next one. Never
+    // migrates entries, so it is safe to use while iterating.
+    iterator erase(iterator it) {
+        erase_at(it.index_);
+        ++it;
+        return it;
+    }
+
+    // Calls visit(iterator) for up to `count` entries, starting at slot
+    // position `cursor` and wrapping around, and returns the position to
+    // resume from. Gives up early after a bounded run of empty slots, so a
+    // sparse table costs little. The visitor may erase(iterator). Cursors
+    // stay usable across resizes; they just land somewhere else.
+    template <typename Visitor>
+    std::size_t scan(std::size_t cursor, std::size_t count, Visitor &&visit) {
+        return scan_impl<iterator>(*this, cursor, count, visit);
+    }
+    template <typename Visitor>
+    std::size_t scan(std::size_t cursor, std::size_t count, Visitor &&visit) const {
+        return scan_impl<const_iterator>(*this, cursor, count, visit);
+    }
+
+    // Bytes held by the slot arrays and control bytes (not by what the
+    // entries point to)
+    std::size_t allocated_bytes() const {
+        return (table_.capacity + old_.capacity) * (sizeof(value_type) + sizeof(ctrl_t));
+    }
+
+    void clear() {
+        release(old_);
+        migrate_pos_ = 0;
+        destroy_slots(table_);
+        if (table_.capacity > 0) {
+            std::fill(table_.ctrl, table_.ctrl + table_.capacity, flat_hash_detail::ctrl_empty);
+        }
+        table_.growth_left = max_load(table_.capacity);
+        size_ = 0;
+    }
+
+    void reserve(std::size_t count) {
+        std::size_t wanted = flat_hash_detail::group_width;
+        while (max_load(wanted) < count) {
+            wanted *= 2;
+        }
+        if (wanted > table_.capacity) {
+            finish_rehash();
+            start_rehash(wanted);
+            finish_rehash();
+        }
+    }
+
+    // Migrates up to `groups` groups of slots from the old table. Returns true
+    // while a migration is still in progress.
+    bool rehash_step(std::size_t groups) {
+        if (!rehashing()) {
+            return false;
+        }
+        std::size_t end = std::min(old_.capacity, migrate_pos_ + groups * group_width);
+        for (; migrate_pos_ < end; ++migrate_pos_) {
+            if (flat_hash_detail::is_full(old_.ctrl[migrate_pos_])) {
+                migrate(migrate_pos_);
+            }
+        }
+        if (migrate_pos_ == old_.capacity) {
+            release(old_);
+            migrate_pos_ = 0;
+            return false;
+        }
+        return true;
+    }
+
+private:
+    using ctrl_t = flat_hash_detail::ctrl_t;
+    using Allocator = SlabStlAllocator<value_type>;
+    using CtrlAllocator = SlabStlAllocator<ctrl_t>;
+    static constexpr std::size_t group_width = flat_hash_detail::group_width;
+    // Tables smaller than this are rehashed in one go, it is cheaper than tracking
+    static constexpr std::size_t incremental_threshold = 4096;
+    static constexpr std::size_t migrate_groups_per_op = 1;
+    // scan() looks at no more than this many slots per requested entry
+    static constexpr std::size_t scan_probe_factor = 8;
+
+    struct Table {
+        ctrl_t *ctrl = nullptr;
+        value_type *slots = nullptr;
+        std::size_t capacity = 0;    // always 0 or a power of two >= group_width
+        std::size_t growth_left = 0; // inserts into empty slots allowed before growing
+    };
+
+    static std::size_t max_load(std::size_t capacity) { return capacity - capacity / 8; }
+
+    template <typename It, typename Map, typename Visitor>
+    static std::size_t scan_impl(Map &map, std::size_t cursor, std::size_t count, Visitor &visit) {
+        std::size_t total = map.slot_count();
+        if (map.size_ == 0) {
+            return 0;
+        }
+        cursor %= total;
+        std::size_t budget = std::min(total, count * scan_probe_factor);
+        for (std::size_t visited = 0; visited < count && budget > 0; budget--) {
+            if (map.full_at(cursor)) {
+                visit(It(&map, cursor));
+                ++visited;
+            }
+            cursor = cursor + 1 == total ? 0 : cursor + 1;
+        }
+        return cursor;
+    }
+    static std::size_t hash_of(std::string_view key) { return std::hash<std::string_view>{}(key); }
+    // High bits pick the group, the low 7 bits go into the control byte
+    static ctrl_t h2(std::size_t hash) { return static_cast<ctrl_t>(hash & 0x7F); }
+    static std::size_t h1(std::size_t hash) { return hash >> 7; }
+
+    // Iteration spans the old table's slots followed by the current table's
+    std::size_t slot_count() const { return old_.capacity + table_.capacity; }
+    bool full_at(std::size_t index) const {
+        return index < old_.capacity ? flat_hash_detail::is_full(old_.ctrl[index])
+                                     : flat_hash_detail::is_full(table_.ctrl[index - old_.capacity]);
+    }
+    value_type &slot_at(std::size_t index) {
+        return index < old_.capacity ? old_.slots[index] : table_.slots[index - old_.capacity];
+    }
+    const value_type &slot_at(std::size_t index) const {
+        return index < old_.capacity ? old_.slots[index] : table_.slots[index - old_.capacity];
+    }
+
+    // Combined index of `key`, or slot_count() when absent
+    std::size_t locate(std::string_view key, std::size_t hash) const {
+        std::size_t index = find_index(table_, key, hash);
+        if (index != table_.capacity) {
+            return old_.capacity + index;
+        }
+        if (rehashing()) {
+            index = find_index(old_, key, hash);
+            if (index != old_.capacity) {
+                return index;
+            }
+        }
+        return slot_count();
+    }
+
+    // Slot holding `key` in `table`, or table.capacity when absent
+    static std::size_t find_index(const Table &table, std::string_view key, std::size_t hash) {
+        if (table.capacity == 0) {
+            return 0;
+        }
+        std::size_t mask = table.capacity / group_width - 1;
+        std::size_t group = h1(hash) & mask;
+        // Triangular probing over groups visits every group exactly once
+        for (std::size_t step = 1;; ++step) {
+            flat_hash_detail::Group g(table.ctrl + group * group_width);
+            for (std::uint32_t match = g.match(h2(hash)); match != 0; match &= match - 1) {
+                std::size_t index = group * group_width + flat_hash_detail::lowest_bit(match);
+                if (table.slots[index].first == key) {
+                    return index;
+                }
+            }
+            if (g.match_empty() != 0 || step > mask) {
+                return table.capacity;
+            }
+            group = (group + step) & mask;
+        }
+    }
+
+    // First empty or deleted slot on the probe sequence of `hash`
+    static std::size_t find_insert_index(const Table &table, std::size_t hash) {
+        std::size_t mask = table.capacity / group_width - 1;
+        std::size_t group = h1(hash) & mask;
+        for (std::size_t step = 1;; ++step) {
+            flat_hash_detail::Group g(table.ctrl + group * group_width);
+            std::uint32_t free = g.match_empty_or_deleted();
+            if (free != 0) {
+                return group * group_width + flat_hash_detail::lowest_bit(free);
+            }
+            group = (group + step) & mask;
+        }
+    }
+
+    // Claims a slot for `hash` in the current table
+    std::size_t claim_slot(std::size_t hash) {
+        std::size_t index = find_insert_index(table_, hash);
+        if (table_.ctrl[index] == flat_hash_detail::ctrl_empty) {
+            --table_.growth_left; // reusing a tombstone does not lengthen any probe sequence
+        }
+        table_.ctrl[index] = h2(hash);
+        return index;
+    }
+
+    template <typename K, typename... Args>
+    std::pair<iterator, bool> emplace_impl(K &&key, Args &&... args) {
+        rehash_step(migrate_groups_per_op);
+
+        std::string_view view(key);
+        std::size_t hash = hash_of(view);
+        std::size_t index = locate(view, hash);
+        if (index != slot_count()) {
+            return {iterator(this, index), false};
+        }
+
+        if (table_.growth_left == 0) {
+            grow();
+        }
+        index = claim_slot(hash);
+        ::new (static_cast<void *>(table_.slots + index))
+            value_type(std::piecewise_construct, std::forward_as_tuple(std::forward<K>(key)),
+                       std::forward_as_tuple(std::forward<Args>(args)...));
+        ++size_;
+        return {iterator(this, old_.capacity + index), true};
+    }
+
+    void erase_at(std::size_t index) {
+        Table &table = index < old_.capacity ? old_ : table_;
+        if (index >= old_.capacity) {
+            index -= old_.capacity;
+        }
+        table.slots[index].~value_type();
+        table.ctrl[index] = flat_hash_detail::ctrl_deleted;
+        --size_;
+    }
+
+    // Moves one entry of the old table into the current one
+    void migrate(std::size_t index) {
+        value_type &slot = old_.slots[index];
+        std::size_t target = claim_slot(hash_of(slot.first));
+        ::new (static_cast<void *>(table_.slots + target)) value_type(std::move(slot));
+        slot.~value_type();
+        // A tombstone keeps the probe chains of the remaining old entries intact
+        old_.ctrl[index] = flat_hash_detail::ctrl_deleted;
+    }
+
+    void grow() {
+        // The previous migration must be complete before another one starts.
+        // With one group migrated per operation it practically always is.
+        finish_rehash();
+
+        if (table_.capacity == 0) {
+            start_rehash(group_width);
+        } else if (size_ <= max_load(table_.capacity) / 2) {
+            // Mostly tombstones: rehash into a table of the same size
+            start_rehash(table_.capacity);
+        } else {
+            start_rehash(table_.capacity * 2);
+        }
+        if (old_.capacity < incremental_threshold) {
+            finish_rehash();
+        }
+    }
+
+    void start_rehash(std::size_t new_capacity) {
+        old_ = table_;
+        migrate_pos_ = 0;
+
+        table_ = Table();
+        table_.ctrl = CtrlAllocator().allocate(new_capacity);
+        std::fill(table_.ctrl, table_.ctrl + new_capacity, flat_hash_detail::ctrl_empty);
+        table_.slots = Allocator().allocate(new_capacity);
+        table_.capacity = new_capacity;
+        table_.growth_left = max_load(new_capacity);
+    }
+
+    void finish_rehash() {
+        while (rehash_step(old_.capacity / group_width + 1)) {
+        }
+    }
+
+    static void destroy_slots(Table &table) {
+        for (std::size_t i = 0; i < table.capacity; ++i) {
+            if (flat_hash_detail::is_full(table.ctrl[i])) {
+                table.slots[i].~value_type();
+            }
+        }
+    }
+
+    static void release(Table &table) {
+        if (table.capacity == 0) {
+            return;
+        }
+        destroy_slots(table);
+        Allocator().deallocate(table.slots, table.capacity);
+        CtrlAllocator().deallocate(table.ctrl, table.capacity);
+        table = Table();
+    }
+
+    Table table_;          // receives every insert
+    Table old_;            // being drained into table_; empty unless rehashing
+    std::size_t migrate_pos_ = 0; // next old_ slot to migrate
+    std::size_t size_ = 0; // entries across both tables
+};
+
+// A set of strings is the same table with an empty mapped value
+struct FlatSetTag {};
+using FlatHashSet = FlatHashMap<FlatSetTag>;
+
+#endif //FLAT_HASH_MAP_H
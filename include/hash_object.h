@@ -0,0 +1,60 @@
+//
+// Hash value with a compact listpack encoding for small hashes.
+//
+
+#ifndef HASH_OBJECT_H
+#define HASH_OBJECT_H
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <variant>
+#include "encoding_limits.h"
+#include "flat_hash_map.h"
+#include "listpack.h"
+
+class HashObject {
+public:
+    using Table = FlatHashMap<SlabString>;
+
+    // Field/value pairs stored alternately in one listpack, or a hash table
+    // once the hash outgrows the listpack limits
+    bool is_listpack() const { return std::holds_alternative<ListPack>(data_); }
+    const char *encoding_name() const { return is_listpack() ? "listpack" : "hashtable"; }
+    std::size_t size() const;
+    // Approximate heap bytes held by the encoding
+    std::size_t memory_usage() const;
+    // Allocations the destructor releases: one for a packed encoding
+    std::size_t free_effort() const;
+
+    // Returns true if the field is new
+    bool set(std::string_view field, std::string_view value, const EncodingLimits &limits);
+    // The view stays valid until the hash is modified
+    bool get(std::string_view field, std::string_view &value) const;
+    bool del(std::string_view field);
+
+    // Calls visit(field, value) for every pair
+    template <typename Visitor>
+    void for_each(Visitor &&visit) const {
+        if (auto *pack = std::get_if<ListPack>(&data_)) {
+            for (std::size_t offset = pack->first(); offset != pack->end();) {
+                std::size_t value = pack->next(offset);
+                visit(pack->get(offset), pack->get(value));
+                offset = pack->next(value);
+            }
+            return;
+        }
+        for (const auto &entry : std::get<Table>(data_)) {
+            visit(std::string_view(entry.first), std::string_view(entry.second));
+        }
+    }
+
+private:
+    void convert_to_table();
+
+    std::variant<ListPack, Table> data_;
+    // Heap bytes of the long field and value strings in the table
+    std::size_t payload_ = 0;
+};
+
+#endif //HASH_OBJECT_H
@@ -0,0 +1,47 @@
+//
+// Cursor-based receive buffer for a client connection.
+//
+
+#ifndef INPUT_BUFFER_H
+#define INPUT_BUFFER_H
+
+#include <cstddef>
+#include <memory>
+#include <string_view>
+
+// Bytes received and not yet consumed, kept in one contiguous block so the
+// parser can hand out views into it. Reads land directly in the free space
+// behind the data and consuming only advances a cursor. The leftover bytes
+// (usually a partial request) are moved to the front only when the space
+// behind them runs short, and the block grows only when that is not enough.
+class InputBuffer {
+public:
+    explicit InputBuffer(std::size_t initial_capacity = 16 * 1024);
+
+    std::string_view data() const { return std::string_view(storage_.get() + start_, end_ - start_); }
+    std::size_t size() const { return end_ - start_; }
+    bool empty() const { return start_ == end_; }
+    std::size_t capacity() const { return capacity_; }
+
+    // Makes at least `min` bytes writable after the data and returns where
+    // they start; writable() tells how many there are. Views into data()
+    // are invalidated.
+    char *prepare(std::size_t min);
+    std::size_t writable() const { return capacity_ - end_; }
+    // Appends `count` bytes written at prepare()'s pointer
+    void commit(std::size_t count) { end_ += count; }
+
+    // Drops `count` bytes from the front
+    void consume(std::size_t count);
+    // Drops `count` bytes starting `offset` bytes into the data
+    void erase(std::size_t offset, std::size_t count);
+
+private:
+    std::unique_ptr<char[]> storage_;
+    std::size_t capacity_;
+    std::size_t initial_capacity_;
+    std::size_t start_ = 0;
+    std::size_t end_ = 0;
+};
+
+#endif //INPUT_BUFFER_H
@@ -0,0 +1,52 @@
+//
+// Set encoding for integer members: a sorted, packed array of integers.
+//
+
+#ifndef INTSET_H
+#define INTSET_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include "slab_allocator.h"
+
+// Members are stored sorted, back to back, all in the narrowest width (2, 4
+// or 8 bytes) that holds every one of them. Inserting a value that needs a
+// wider type upgrades the whole array once; the width never shrinks.
+//
+// Lookups binary search down to a short window and then count the elements
+// below the target with SIMD compares (AVX2 when the build enables it, SSE2
+// otherwise, scalar code as a fallback).
+class IntSet {
+public:
+    // Accepts only the canonical decimal form (no sign on zero, no leading
+    // zeros or spaces), so a member always prints back exactly as given
+    static bool parse(std::string_view text, std::int64_t &value);
+
+    std::size_t size() const { return buf_.size() / width_; }
+    bool empty() const { return buf_.empty(); }
+    std::size_t bytes() const { return buf_.size(); }
+    std::size_t width() const { return width_; }
+
+    std::int64_t at(std::size_t index) const;
+    std::int64_t front() const { return at(0); }
+    std::int64_t back() const { return at(size() - 1); }
+
+    bool contains(std::int64_t value) const;
+    // Both return false if the set did not change
+    bool insert(std::int64_t value);
+    bool erase(std::int64_t value);
+
+private:
+    static std::size_t width_for(std::int64_t value);
+    // Index of the first element not less than `value`
+    std::size_t lower_bound(std::int64_t value) const;
+    void store(std::size_t index, std::int64_t value);
+    void upgrade(std::size_t width);
+
+    SlabString buf_;
+    std::size_t width_ = sizeof(std::int16_t);
+};
+
+#endif //INTSET_H
@@ -0,0 +1,64 @@
+//
+// Background destruction of large values, in the spirit of Redis' lazyfree.
+//
+
+#ifndef LAZY_FREE_H
+#define LAZY_FREE_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <utility>
+
+// Takes ownership of objects and destroys them on a dedicated thread, so
+// deleting a collection with millions of elements costs the caller a move
+// instead of millions of frees while it holds a lock or blocks its loop.
+class LazyFree {
+public:
+    // The process-wide reclaimer, started on first use
+    static LazyFree &shared();
+
+    LazyFree();
+    // Destroys whatever is still queued, then stops the thread
+    ~LazyFree();
+    LazyFree(const LazyFree &) = delete;
+    LazyFree &operator=(const LazyFree &) = delete;
+
+    template <typename T>
+    void free(T &&object) {
+        static_assert(!std::is_lvalue_reference<T>::value, "LazyFree takes ownership; pass an rvalue");
+        enqueue(std::make_unique<Holder<T>>(std::move(object)));
+    }
+
+    // Objects queued but not yet destroyed
+    std::size_t pending() const;
+    // Blocks until everything queued so far has been destroyed
+    void drain();
+
+private:
+    struct Garbage {
+        virtual ~Garbage() = default;
+    };
+    template <typename T>
+    struct Holder : Garbage {
+        explicit Holder(T &&object) : object(std::move(object)) {}
+        T object;
+    };
+
+    void enqueue(std::unique_ptr<Garbage> garbage);
+    void run();
+
+    mutable std::mutex mutex_;
+    std::condition_variable wake_;
+    std::condition_variable idle_;
+    std::deque<std::unique_ptr<Garbage>> queue_;
+    std::size_t pending_ = 0; // queued plus the batch being destroyed
+    bool stopping_ = false;
+    std::thread thread_;
+};
+
+#endif //LAZY_FREE_H
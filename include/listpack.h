@@ -0,0 +1,61 @@
+//
+// Contiguous, length-prefixed encoding for small sequences of strings.
+//
+
+#ifndef LISTPACK_H
+#define LISTPACK_H
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include "slab_allocator.h"
+
+// Entries are packed back to back in one buffer as
+//     <varint length> <bytes> <backlen>
+// where backlen is the size of the first two parts encoded so it can be read
+// from its last byte backwards. That makes the pack walkable in both
+// directions with no per-entry pointers or allocations.
+//
+// Entries are addressed by byte offset: first() is the first entry, end() is
+// one past the last, and next()/prev() step between them.
+class ListPack {
+public:
+    std::size_t size() const { return count_; }
+    bool empty() const { return count_ == 0; }
+    std::size_t bytes() const { return buf_.size(); }
+
+    std::size_t first() const { return 0; }
+    std::size_t end() const { return buf_.size(); }
+    std::size_t last() const { return buf_.empty() ? end() : prev(end()); }
+    std::size_t next(std::size_t offset) const;
+    std::size_t prev(std::size_t offset) const;
+    std::string_view get(std::size_t offset) const;
+
+    std::string_view front() const { return get(first()); }
+    std::string_view back() const { return get(last()); }
+
+    void push_back(std::string_view value) { insert(end(), value); }
+    void push_front(std::string_view value) { insert(first(), value); }
+    void pop_front() { erase(first()); }
+    void pop_back() { erase(last()); }
+
+    // Inserts before the entry at `offset` (or appends at end()); the new
+    // entry then starts at `offset`
+    void insert(std::size_t offset, std::string_view value);
+    // Removes the entry at `offset`; the following entry moves to `offset`
+    void erase(std::size_t offset);
+    void replace(std::size_t offset, std::string_view value);
+
+    // Offset of the first entry equal to `value`, looking at every `stride`-th
+    // entry (e.g. 2 to search only the fields of field/value pairs), or end()
+    std::size_t find(std::string_view value, std::size_t stride = 1) const;
+
+    // Bytes a value would occupy once encoded
+    static std::size_t encoded_size(std::size_t length);
+
+private:
+    SlabString buf_;
+    std::size_t count_ = 0;
+};
+
+#endif //LISTPACK_H
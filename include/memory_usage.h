@@ -0,0 +1,18 @@
+//
+// Helpers for estimating the memory held by stored values.
+//
+
+#ifndef MEMORY_USAGE_H
+#define MEMORY_USAGE_H
+
+#include <cstddef>
+#include <string>
+
+// Heap bytes a std::string of `length` characters allocates: nothing while
+// it fits the inline (SSO) buffer, otherwise its characters plus terminator
+inline std::size_t string_heap_bytes(std::size_t length) {
+    constexpr std::size_t inline_capacity = 15;
+    return length > inline_capacity ? length + 1 : 0;
+}
+
+#endif //MEMORY_USAGE_H
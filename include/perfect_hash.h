@@ -0,0 +1,97 @@
+//
+// Compile-time, case-insensitive perfect hashing of a fixed set of names.
+//
+
+#ifndef PERFECT_HASH_H
+#define PERFECT_HASH_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+// Maps each name of a static table to its position with one hash and one
+// compare. The index is built by a constexpr search for a hash seed under
+// which no two names share a slot, so a lookup never probes: the slot either
+// holds the only candidate or is empty. ASCII letters are folded to upper
+// case while hashing and comparing.
+namespace perfect_hash {
+
+    constexpr char fold(char c) {
+        return c >= 'a' && c <= 'z' ? static_cast<char>(c - 'a' + 'A') : c;
+    }
+
+    constexpr bool equals_folded(std::string_view a, std::string_view b) {
+        if (a.size() != b.size()) {
+            return false;
+        }
+        for (std::size_t i = 0; i < a.size(); i++) {
+            if (fold(a[i]) != fold(b[i])) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // FNV-1a over the folded bytes, starting from a seed-dependent basis
+    constexpr std::uint32_t hash(std::string_view name, std::uint32_t seed) {
+        std::uint32_t h = 2166136261u ^ (seed * 0x9E3779B9u);
+        for (char c : name) {
+            h ^= static_cast<unsigned char>(fold(c));
+            h *= 16777619u;
+        }
+        return h ^ (h >> 15);
+    }
+
+    // `Slots` must be a power of two; the table may hold up to 255 names
+    template <std::size_t Slots>
+    struct Index {
+        static_assert((Slots & (Slots - 1)) == 0, "slot count must be a power of two");
+        static constexpr std::uint8_t empty = 0xFF;
+        static constexpr std::size_t npos = static_cast<std::size_t>(-1);
+
+        std::uint32_t seed = 0;
+        bool valid = false; // false if no seed was found; rejected by static_assert at the use site
+        std::array<std::uint8_t, Slots> slots{};
+
+        constexpr std::size_t slot_of(std::string_view name) const {
+            return hash(name, seed) & (Slots - 1);
+        }
+
+        // Position of `name` in `items` (whose elements have a `name` member), or npos
+        template <typename T, std::size_t N>
+        constexpr std::size_t find(std::string_view name, const T (&items)[N]) const {
+            std::uint8_t position = slots[slot_of(name)];
+            if (position == empty || !equals_folded(items[position].name, name)) {
+                return npos;
+            }
+            return position;
+        }
+    };
+
+    template <std::size_t Slots, typename T, std::size_t N>
+    constexpr Index<Slots> build(const T (&items)[N], std::uint32_t max_seed = 100000) {
+        static_assert(N < Index<Slots>::empty, "too many names for an 8-bit index");
+        Index<Slots> index;
+        for (std::uint32_t seed = 0; seed < max_seed; seed++) {
+            index.seed = seed;
+            for (auto &slot : index.slots) {
+                slot = Index<Slots>::empty;
+            }
+            bool collision = false;
+            for (std::size_t i = 0; i < N && !collision; i++) {
+                std::size_t slot = index.slot_of(items[i].name);
+                collision = index.slots[slot] != Index<Slots>::empty;
+                index.slots[slot] = static_cast<std::uint8_t>(i);
+            }
+            if (!collision) {
+                index.valid = true;
+                return index;
+            }
+        }
+        return index;
+    }
+
+}
+
+#endif //PERFECT_HASH_H
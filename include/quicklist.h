@@ -0,0 +1,79 @@
+//
+// List encoding: a linked sequence of packed listpack blocks.
+//
+
+#ifndef QUICKLIST_H
+#define QUICKLIST_H
+
+#include <cstddef>
+#include <list>
+#include <string>
+#include <string_view>
+#include "listpack.h"
+#include "slab_allocator.h"
+
+// Each node is a ListPack of at most max_node_bytes (a larger single element
+// gets a node of its own). Pushing or popping at either end only touches the
+// end node, so it costs O(1) regardless of list length, while ranges are read
+// by walking contiguous node buffers.
+class QuickList {
+public:
+    static constexpr std::size_t max_node_bytes = 8 * 1024;
+
+    std::size_t size() const { return count_; }
+    bool empty() const { return count_ == 0; }
+    // Approximate heap bytes held by the nodes
+    std::size_t memory_usage() const {
+        return bytes_ + nodes_.size() * (sizeof(ListPack) + 2 * sizeof(void *));
+    }
+    // Allocations the destructor releases
+    std::size_t free_effort() const { return nodes_.size(); }
+
+    void push_front(std::string_view value);
+    void push_back(std::string_view value);
+    // Both return false (leaving `out` untouched) when the list is empty
+    bool pop_front(std::string &out);
+    bool pop_back(std::string &out);
+    // Discard the end element; false when the list is empty
+    bool pop_front();
+    bool pop_back();
+    // End elements of a non-empty list, valid until the list changes
+    std::string_view front() const { return nodes_.front().front(); }
+    std::string_view back() const { return nodes_.back().back(); }
+
+    // Calls visit(std::string_view) for elements start..end inclusive; the
+    // indexes must already be clamped to the list
+    template <typename Visitor>
+    void for_range(std::size_t start, std::size_t end, Visitor &&visit) const {
+        auto node = nodes_.begin();
+        // Skip whole nodes up to the one holding `start`
+        while (start >= node->size()) {
+            start -= node->size();
+            end -= node->size();
+            ++node;
+        }
+        std::size_t remaining = end - start + 1;
+        std::size_t offset = node->first();
+        for (std::size_t i = 0; i < start; ++i) {
+            offset = node->next(offset);
+        }
+        while (remaining > 0) {
+            if (offset == node->end()) {
+                ++node;
+                offset = node->first();
+            }
+            visit(node->get(offset));
+            offset = node->next(offset);
+            --remaining;
+        }
+    }
+
+private:
+    static bool fits(const ListPack &node, std::string_view value);
+
+    std::list<ListPack, SlabStlAllocator<ListPack>> nodes_;
+    std::size_t count_ = 0;
+    std::size_t bytes_ = 0; // encoded bytes across all nodes
+};
+
+#endif //QUICKLIST_H
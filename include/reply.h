@@ -0,0 +1,52 @@
+//
+// Reply serialization shared by every command.
+//
+
+#ifndef REPLY_H
+#define REPLY_H
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "command_parser.h"
+#include "shared_buffer.h"
+
+// A shared buffer to be sent in place, right after the first `offset` bytes
+// of the reply string, instead of being copied into it
+struct ReplySplice {
+    std::size_t offset;
+    SharedBuffer buffer;
+};
+
+// Appends replies to an output string in the protocol the request used.
+// RESP clients get proper RESP2 frames; inline clients get plain text lines,
+// with array elements separated by spaces on a single line.
+// Given a splice list, shared bulk values are recorded there rather than
+// copied, for the caller to send with scatter/gather I/O.
+class ReplyBuilder {
+public:
+    ReplyBuilder(std::string &out, Protocol protocol, std::vector<ReplySplice> *splices = nullptr);
+
+    void status(std::string_view message);   // +OK
+    void error(std::string_view message);    // -ERR ... (message carries the error code)
+    void integer(long long value);           // :42
+    void bulk(std::string_view value);       // $5\r\nhello
+    void bulk(const SharedBuffer &value);    // same, spliced in when possible
+    void null();                             // $-1
+    void array(std::size_t length);          // *3, followed by `length` elements
+
+    Protocol protocol() const { return protocol_; }
+
+private:
+    void begin_element();
+    void end_element();
+
+    std::string &out_;
+    Protocol protocol_;
+    std::vector<ReplySplice> *splices_;
+    std::size_t pending_elements_ = 0; // inline mode: elements left in the current array
+    bool first_element_ = false;
+};
+
+#endif //REPLY_H
@@ -6,19 +6,42 @@
 #define SERVER_H
 
 #include<boost/asio.hpp>
+#include <vector>
 #include "database.h"
 
 using boost::asio::ip::tcp;
 
+class Shard;
+
 class Server {
 public:
-    Server(boost::asio::io_context& io_context, short port, Database& db);
+    // reuse_port binds with SO_REUSEPORT so several acceptors, one per event
+    // loop, can listen on the same port and let the kernel balance connections.
+    // When session_contexts is given, accepted sessions are spread round-robin
+    // over those loops instead of running on the acceptor's own loop.
+    Server(boost::asio::io_context& io_context, short port, Database& db, bool reuse_port = false,
+           std::vector<boost::asio::io_context*> session_contexts = {});
+
+    // Shared-nothing mode: sessions are spread round-robin over `shards`, each
+    // running on its shard's loop against that shard's keyspace partition.
+    Server(boost::asio::io_context& io_context, short port, const std::vector<Shard*>& shards, bool reuse_port);
+
+    static bool reusePortSupported();
+    // The port actually listened on, e.g. when 0 was asked for
+    unsigned short port() const;
 
 private:
-    void doAccept();
+    // Where an accepted connection is placed
+    struct Target {
+        boost::asio::io_context* loop;
+        Database* db;
+        Shard* shard;
+    };
 
+    void doAccept();
     tcp::acceptor acceptor_;
-    Database& db_;
+    std::vector<Target> targets_;
+    std::size_t next_target_ = 0;
 };
 
 #endif //SERVER_H
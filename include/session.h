@@ -7,27 +7,81 @@
 
 #include <iostream>
 #include <string>
+#include <string_view>
+#include <vector>
 #include <boost/asio.hpp>
 #include <memory>
+#include "command_parser.h"
 #include "database.h"
+#include "input_buffer.h"
+#include "reply.h"
+
+class CommandArgs;
+class Shard;
 
 using boost::asio::ip::tcp;
 
 class Session : public std::enable_shared_from_this<Session> {
 public:
-    Session(tcp::socket socket, Database& db);
+    // With a shard, commands on keys owned by other shards are forwarded there.
+    // Handlers run on the socket's executor, which must be a strand when
+    // several threads run the loop (see Server::doAccept).
+    Session(tcp::socket socket, Database& db, Shard* shard = nullptr);
     void start();
 
+    // Delivers the reply of a forwarded command; runs on this session's loop
+    void onRemoteReply(std::string reply);
+
 private:
     void doRead();
-    void doWrite(const std::string& response);
+    void processInput(std::string response = {}, bool prompt = false);
+    void resumeReading();
+    // Reads the rest of the large last argument of the request at `offset`
+    // into payload_ instead of input_
+    void startPayload(std::size_t offset, const ParseResult &parsed);
+    // The command's tokens as owned strings, for running it on another shard
+    std::vector<std::string> owned_command(const CommandArgs &args);
+    // Keeps a written reply buffer so later replies reuse its capacity
+    void recycle(std::string buffer);
+    // Queues a reply buffer with the shared values spliced into it; replies
+    // are written strictly in queue order
+    void queueReply(std::string reply, std::vector<ReplySplice> splices);
+    void doWrite();
 
     tcp::socket socket_;
-    static constexpr std::size_t max_length = 1024;
-    char data_[max_length];
+    static constexpr std::size_t input_capacity = 16 * 1024; // large enough for a deep pipeline per read
+    static constexpr std::size_t min_read = 4 * 1024;
+    // A last bulk argument at least this long is read into its own string,
+    // which SET then moves into the keyspace
+    static constexpr std::size_t direct_read_min = 16 * 1024;
+    // Stop reading from a client that does not drain its replies
+    static constexpr std::size_t max_output_backlog = 4 * 1024 * 1024;
+    static constexpr std::size_t max_spare_buffers = 4;
+    static constexpr std::size_t max_spare_capacity = 64 * 1024;
     Database& db_;
-    std::string buffer_;
-    std::string write_buffer_;
+    InputBuffer input_{input_capacity};
+    std::vector<std::string_view> tokens_; // reused across commands, views into input_
+    ParseState parse_state_;               // progress through the request at the front of input_
+    std::string payload_;                  // large last argument being received
+    std::size_t payload_received_ = 0;
+    std::size_t payload_head_ = 0;         // bytes of the request before the payload
+    bool payload_pending_ = false;         // payload_ belongs to the request at the front of input_
+    Shard* shard_;
+    bool awaiting_remote_ = false;          // a forwarded command's reply is outstanding
+    bool remote_prompt_ = false;
+
+    struct PendingReply {
+        std::string bytes;
+        std::vector<ReplySplice> splices; // keep the spliced values alive until written
+    };
+    std::vector<PendingReply> output_queue_; // replies waiting for the next write
+    std::vector<std::string> spare_buffers_; // emptied reply buffers, capacity kept
+    std::vector<PendingReply> in_flight_;   // replies owned by the current async_write
+    std::vector<boost::asio::const_buffer> write_buffers_;
+    std::size_t queued_bytes_ = 0;
+    bool writing_ = false;
+    bool read_paused_ = false;
+    bool closing_ = false;                  // close once the output queue has drained
 };
 
 #endif //SESSION_H
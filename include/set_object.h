@@ -0,0 +1,69 @@
+//
+// Set value with compact encodings for small and all-integer sets.
+//
+
+#ifndef SET_OBJECT_H
+#define SET_OBJECT_H
+
+#include <charconv>
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <variant>
+#include "encoding_limits.h"
+#include "flat_hash_map.h"
+#include "intset.h"
+#include "listpack.h"
+
+class SetObject {
+public:
+    using Table = FlatHashSet;
+
+    // A set starts as an intset while every member is an integer, moves to a
+    // listpack when another member arrives while it is still small, and to a
+    // full table once it outgrows the compact limits. It never converts back.
+    const char *encoding_name() const;
+    std::size_t size() const;
+    // Approximate heap bytes held by the encoding
+    std::size_t memory_usage() const;
+    // Allocations the destructor releases: one for a packed encoding
+    std::size_t free_effort() const;
+
+    // Return true if the set changed
+    bool add(std::string_view member, const EncodingLimits &limits);
+    bool remove(std::string_view member);
+    bool contains(std::string_view member) const;
+
+    // Calls visit(member) for every member
+    template <typename Visitor>
+    void for_each(Visitor &&visit) const {
+        if (auto *ints = std::get_if<IntSet>(&data_)) {
+            char digits[24];
+            for (std::size_t i = 0; i < ints->size(); i++) {
+                auto result = std::to_chars(digits, digits + sizeof(digits), ints->at(i));
+                visit(std::string_view(digits, result.ptr - digits));
+            }
+            return;
+        }
+        if (auto *pack = std::get_if<ListPack>(&data_)) {
+            for (std::size_t offset = pack->first(); offset != pack->end(); offset = pack->next(offset)) {
+                visit(pack->get(offset));
+            }
+            return;
+        }
+        for (const auto &entry : std::get<Table>(data_)) {
+            visit(std::string_view(entry.first));
+        }
+    }
+
+private:
+    // Moves out of the intset for a non-integer member
+    void convert_from_intset(std::string_view member, const EncodingLimits &limits);
+    void convert_to_table();
+
+    std::variant<IntSet, ListPack, Table> data_;
+    // Heap bytes of the long member strings in the table
+    std::size_t payload_ = 0;
+};
+
+#endif //SET_OBJECT_H
@@ -0,0 +1,100 @@
+//
+// Shared-nothing keyspace partitioning for thread-per-core mode.
+//
+
+#ifndef SHARD_H
+#define SHARD_H
+
+#include <atomic>
+#include <deque>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <boost/asio.hpp>
+#include "command_parser.h"
+#include "database.h"
+#include "spsc_queue.h"
+
+class Session;
+class ShardSet;
+
+// A request shipped to the shard owning its key, or the reply coming back.
+struct ShardMessage {
+    std::vector<std::string> command; // empty for a reply
+    std::string reply;
+    Protocol protocol = Protocol::Resp;
+    std::shared_ptr<Session> session; // origin session, only touched on its own shard
+    std::size_t origin = 0;
+    // Run on every shard in turn starting after the origin; the last one replies
+    bool broadcast = false;
+};
+
+// One event loop together with the keyspace partition it owns. The partition
+// is an unsynchronized Database: only this shard's loop thread ever touches it.
+// Other shards reach it exclusively through lock-free SPSC mailboxes.
+class Shard {
+public:
+    Shard(ShardSet &shards, std::size_t id, boost::asio::io_context &loop);
+
+    std::size_t id() const { return id_; }
+    boost::asio::io_context &loop() { return loop_; }
+    Database &database() { return db_; }
+
+    // Returned by route() for a multi-key command whose keys live on different shards
+    static constexpr std::size_t cross_shard = static_cast<std::size_t>(-1);
+    // Returned by route() for a command every shard must run, e.g. FLUSHALL
+    static constexpr std::size_t all_shards = static_cast<std::size_t>(-2);
+
+    // Shard owning the key(s) a command operates on (this shard for keyless ones)
+    std::size_t route(const std::vector<std::string_view> &tokens) const;
+
+    // Executes `command` on shard `target`. The reply is handed back to
+    // `session` on this shard's loop through Session::onRemoteReply.
+    void forward(std::size_t target, std::vector<std::string> command, Protocol protocol,
+                 std::shared_ptr<Session> session);
+    // Runs an all_shards `command` on the other shards one after another,
+    // after the caller ran it here. Returns false if there are no others;
+    // otherwise the last shard's reply comes back like forward()'s.
+    bool forwardToOthers(std::vector<std::string> command, Protocol protocol, std::shared_ptr<Session> session);
+
+private:
+    friend class ShardSet;
+
+    void send(std::size_t target, std::unique_ptr<ShardMessage> message);
+    void flushBacklog();
+    void drain();
+    void handle(std::unique_ptr<ShardMessage> message);
+
+    ShardSet &shards_;
+    std::size_t id_;
+    boost::asio::io_context &loop_;
+    Database db_{false};
+    std::atomic<bool> drain_scheduled_{false};
+    std::vector<std::string_view> tokens_; // views into the message being handled
+    // Messages that did not fit a full mailbox, per target; producer-only
+    std::vector<std::deque<std::unique_ptr<ShardMessage>>> backlog_;
+    bool backlog_retry_scheduled_ = false;
+};
+
+class ShardSet {
+public:
+    // One shard per loop; each loop must be run by exactly one thread.
+    explicit ShardSet(const std::vector<boost::asio::io_context *> &loops);
+
+    std::size_t size() const { return shards_.size(); }
+    Shard &shard(std::size_t index) { return *shards_[index]; }
+    std::size_t ownerOf(std::string_view key) const;
+
+private:
+    friend class Shard;
+    using Mailbox = SpscQueue<std::unique_ptr<ShardMessage>>;
+    static constexpr std::size_t mailbox_capacity = 4096;
+
+    Mailbox &mailbox(std::size_t from, std::size_t to) { return *mailboxes_[from * size() + to]; }
+
+    std::vector<std::unique_ptr<Shard>> shards_;
+    std::vector<std::unique_ptr<Mailbox>> mailboxes_; // one per (from, to) pair
+};
+
+#endif //SHARD_H
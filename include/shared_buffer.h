@@ -0,0 +1,64 @@
+//
+// Reference-counted immutable byte buffer for large string values.
+//
+
+#ifndef SHARED_BUFFER_H
+#define SHARED_BUFFER_H
+
+#include <atomic>
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <utility>
+#include "memory_usage.h"
+#include "slab_allocator.h"
+
+// A handle to bytes that never change once stored. Copying a handle only
+// bumps a counter, so a reader can pin a large value under a lock and use
+// it after the lock is gone: the keyspace may overwrite or delete the key
+// meanwhile, and the last handle to go frees the bytes, on whatever thread
+// that is. The bytes are kept in a std::string that is moved in, so storing
+// a value that has just been received never copies it.
+class SharedBuffer {
+public:
+    SharedBuffer() = default;
+    explicit SharedBuffer(std::string bytes) : block_(slab_new<Block>(std::move(bytes))) {}
+    SharedBuffer(const SharedBuffer &other) noexcept : block_(other.block_) {
+        if (block_ != nullptr) {
+            block_->refs.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+    SharedBuffer(SharedBuffer &&other) noexcept : block_(std::exchange(other.block_, nullptr)) {}
+    SharedBuffer &operator=(SharedBuffer other) noexcept {
+        std::swap(block_, other.block_);
+        return *this;
+    }
+    ~SharedBuffer() {
+        // The decrement publishes this handle's reads to whoever frees the block
+        if (block_ != nullptr && block_->refs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            slab_delete(block_);
+        }
+    }
+
+    explicit operator bool() const { return block_ != nullptr; }
+    std::string_view view() const { return block_ != nullptr ? std::string_view(block_->bytes) : std::string_view(); }
+    const char *data() const { return view().data(); }
+    std::size_t size() const { return view().size(); }
+    // Handles sharing the bytes, this one included (0 for an empty handle)
+    std::size_t use_count() const { return block_ != nullptr ? block_->refs.load(std::memory_order_relaxed) : 0; }
+    // Heap bytes held by the buffer, counted once however many handles exist
+    std::size_t memory_usage() const {
+        return block_ != nullptr ? sizeof(Block) + string_heap_bytes(block_->bytes.capacity()) : 0;
+    }
+
+private:
+    struct Block {
+        explicit Block(std::string bytes) : bytes(std::move(bytes)) {}
+        std::atomic<std::size_t> refs{1};
+        const std::string bytes;
+    };
+
+    Block *block_ = nullptr;
+};
+
+#endif //SHARED_BUFFER_H
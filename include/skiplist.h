@@ -0,0 +1,100 @@
+//
+// Skiplist ordering sorted-set members by (score, member), with rank spans.
+//
+
+#ifndef SKIPLIST_H
+#define SKIPLIST_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include "slab_allocator.h"
+
+// Inclusive or exclusive bounds on a score, as in ZRANGEBYSCORE min max
+struct ScoreRange {
+    double min = 0;
+    double max = 0;
+    bool min_exclusive = false;
+    bool max_exclusive = false;
+
+    bool above_min(double score) const { return min_exclusive ? score > min : score >= min; }
+    bool below_max(double score) const { return max_exclusive ? score < max : score <= max; }
+    bool contains(double score) const { return above_min(score) && below_max(score); }
+    bool empty() const { return min > max || (min == max && (min_exclusive || max_exclusive)); }
+};
+
+// Each level's forward link records how many nodes it skips (its span), so
+// the rank of a node is the sum of the spans walked to reach it. That makes
+// rank lookups and "node at rank r" O(log n) alongside the usual ordered
+// search. Nodes are single allocations with their levels stored inline.
+class SkipList {
+public:
+    static constexpr int max_level = 32;
+
+    class Node {
+    public:
+        const SlabString &member() const { return member_; }
+        double score() const { return score_; }
+        const Node *next() const { return levels()[0].forward; }
+
+    private:
+        friend class SkipList;
+        struct Level {
+            Node *forward;
+            std::size_t span;
+        };
+
+        Node(double score, std::string_view member, int height)
+            : member_(member), score_(score), height_(static_cast<std::uint8_t>(height)) {}
+        Level *levels() { return reinterpret_cast<Level *>(this + 1); }
+        const Level *levels() const { return reinterpret_cast<const Level *>(this + 1); }
+
+        SlabString member_;
+        double score_;
+        Node *backward_ = nullptr;
+        std::uint8_t height_;
+    };
+
+    SkipList();
+    ~SkipList();
+    SkipList(const SkipList &) = delete;
+    SkipList &operator=(const SkipList &) = delete;
+    SkipList(SkipList &&other) noexcept;
+    SkipList &operator=(SkipList &&other) noexcept;
+
+    std::size_t size() const { return length_; }
+    // Heap bytes held by the nodes, including long member strings
+    std::size_t memory_usage() const { return bytes_; }
+
+    // The member must not already be present
+    void insert(double score, std::string_view member);
+    bool erase(double score, std::string_view member);
+
+    // 0-based rank of a member known to be in the list with this score
+    std::size_t rank(double score, std::string_view member) const;
+    // Node at a 0-based rank, or nullptr if out of range
+    const Node *at_rank(std::size_t rank) const;
+    // 0-based rank of the first node at or after the lower edge of `range`,
+    // and one past the last node within its upper edge
+    std::size_t lower_rank(const ScoreRange &range) const;
+    std::size_t upper_rank(const ScoreRange &range) const;
+
+private:
+    static Node *create_node(int height, double score, std::string_view member);
+    static std::size_t node_bytes(int height, std::size_t member_length);
+    static void destroy_node(Node *node);
+    static int random_level();
+    // Whether (score, member) sorts before node's entry
+    static bool before(const Node *node, double score, std::string_view member);
+
+    void release();
+
+    Node *header_;
+    Node *tail_ = nullptr;
+    std::size_t length_ = 0;
+    std::size_t bytes_ = 0;
+    int level_ = 1;
+};
+
+#endif //SKIPLIST_H
@@ -0,0 +1,95 @@
+//
+// Size-class slab allocator with per-thread caches for keyspace objects.
+//
+
+#ifndef SLAB_ALLOCATOR_H
+#define SLAB_ALLOCATOR_H
+
+#include <cstddef>
+#include <new>
+#include <string>
+#include <utility>
+
+// Small objects (up to max_size bytes) are rounded up to one of a few size
+// classes and carved out of 64KB slabs. Each thread keeps a free list per
+// class, so the common allocate/free pair takes no lock and touches no
+// shared cache line. When a thread's list grows long (e.g. on the lazy-free
+// thread, which only frees) half of it moves to a central list per class,
+// where other threads refill from. Slabs are never returned to the system,
+// but blocks of a class are always reused before a new slab is carved.
+// Larger requests go straight to the global allocator.
+class SlabAllocator {
+public:
+    static constexpr std::size_t max_size = 1024;
+    static constexpr std::size_t slab_size = 64 * 1024;
+
+    struct Stats {
+        std::size_t reserved = 0;  // bytes in slabs
+        std::size_t allocated = 0; // bytes in blocks handed out (class sizes)
+        std::size_t requested = 0; // bytes callers asked for
+        // Slab bytes held per byte actually requested. 1.0 is perfect; the
+        // excess is rounding to size classes plus free blocks in slabs.
+        double fragmentation_ratio() const {
+            return requested == 0 ? 1.0 : static_cast<double>(reserved) / static_cast<double>(requested);
+        }
+    };
+
+    static void *allocate(std::size_t size);
+    // `size` must be the size passed to allocate()
+    static void deallocate(void *pointer, std::size_t size) noexcept;
+    // Process-wide totals, summed over the thread caches
+    static Stats stats();
+
+    // Block size a request of `size` bytes (<= max_size) occupies
+    static std::size_t class_size(std::size_t size);
+};
+
+// Constructs a T in a slab block
+template <typename T, typename... Args>
+T *slab_new(Args &&... args) {
+    void *memory = SlabAllocator::allocate(sizeof(T));
+    try {
+        return new (memory) T(std::forward<Args>(args)...);
+    } catch (...) {
+        SlabAllocator::deallocate(memory, sizeof(T));
+        throw;
+    }
+}
+
+template <typename T>
+void slab_delete(T *object) noexcept {
+    if (object != nullptr) {
+        object->~T();
+        SlabAllocator::deallocate(object, sizeof(T));
+    }
+}
+
+// Standard allocator interface over SlabAllocator, for containers
+template <typename T>
+class SlabStlAllocator {
+public:
+    using value_type = T;
+
+    SlabStlAllocator() noexcept = default;
+    template <typename U>
+    SlabStlAllocator(const SlabStlAllocator<U> &) noexcept {}
+
+    T *allocate(std::size_t count) {
+        return static_cast<T *>(SlabAllocator::allocate(count * sizeof(T)));
+    }
+    void deallocate(T *pointer, std::size_t count) noexcept {
+        SlabAllocator::deallocate(pointer, count * sizeof(T));
+    }
+
+    template <typename U>
+    bool operator==(const SlabStlAllocator<U> &) const noexcept { return true; }
+    template <typename U>
+    bool operator!=(const SlabStlAllocator<U> &) const noexcept { return false; }
+};
+
+// A std::string whose buffer comes from the slab allocator, for the bytes
+// the keyspace keeps: keys, short string values, fields and members, and
+// the packed encodings. Short strings stay inline as with std::string.
+using SlabString = std::basic_string<char, std::char_traits<char>, SlabStlAllocator<char>>;
+
+#endif //SLAB_ALLOCATOR_H
@@ -0,0 +1,104 @@
+//
+// Hierarchical timing wheel of key deadlines, at millisecond resolution.
+//
+
+#ifndef TIMER_WHEEL_H
+#define TIMER_WHEEL_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+#include "memory_usage.h"
+
+// Level 0 has one slot per millisecond for the current 64ms block, level 1
+// one slot per 64ms block of the current 4s span, and so on up to ~4.6
+// hours; later deadlines wait in an overflow list. Inserting is O(1), and
+// an entry moves down one level each time the wheel reaches its block, so
+// finding due keys costs O(1) amortized per entry.
+//
+// Entries are never removed early. When one fires, the owner decides
+// whether it is stale, due, or should move on to a later deadline, so a
+// key whose TTL keeps being extended can keep a single entry.
+class TimerWheel {
+public:
+    // Returned by a fire callback to drop the entry
+    static constexpr std::uint64_t none = UINT64_MAX;
+
+    // `now` is the first tick the wheel will fire
+    explicit TimerWheel(std::uint64_t now) : current_(now) {}
+
+    std::size_t size() const { return size_; }
+    // Heap bytes held by the entries' keys, for memory accounting
+    std::size_t memory_usage() const { return size_ * sizeof(Entry) + key_bytes_; }
+
+    // Deadlines at or before the current tick fire on the next advance()
+    void insert(std::string_view key, std::uint64_t tick);
+
+    // Fires every entry due at or before `now`, calling fire(key, tick) for
+    // each. fire returns the tick to file the entry under again, or none;
+    // a tick that is not in the future retries it on the next tick.
+    // Between entries stop() is polled; once it returns true the wheel keeps
+    // its place and advance() returns false.
+    template <typename Fire, typename Stop>
+    bool advance(std::uint64_t now, Fire &&fire, Stop &&stop) {
+        while (current_ <= now) {
+            if (size_ == 0) {
+                current_ = now + 1;
+                break;
+            }
+            if (!cascaded_) {
+                cascade();
+                cascaded_ = true;
+            }
+            auto &slot = levels_[0][current_ & slot_mask];
+            while (!slot.empty()) {
+                if (stop()) {
+                    return false;
+                }
+                Entry entry = std::move(slot.back());
+                slot.pop_back();
+                size_--;
+                std::uint64_t next = fire(std::string_view(entry.key), entry.tick);
+                if (next != none) {
+                    place(std::move(entry.key), next, next > current_ ? next : current_ + 1);
+                } else {
+                    key_bytes_ -= string_heap_bytes(entry.key.size());
+                }
+            }
+            current_++;
+            cascaded_ = false;
+        }
+        return true;
+    }
+
+private:
+    static constexpr std::size_t level_bits = 6;
+    static constexpr std::size_t slots_per_level = std::size_t(1) << level_bits;
+    static constexpr std::size_t slot_mask = slots_per_level - 1;
+    static constexpr std::size_t level_count = 4;
+
+    struct Entry {
+        std::string key;
+        std::uint64_t tick; // the deadline the entry was created for
+    };
+    using Slot = std::vector<Entry>;
+
+    // Files an entry due at `due` (never before the current tick)
+    void place(std::string key, std::uint64_t tick, std::uint64_t due);
+    // On entering a new block, moves the entries of the higher-level slots
+    // that cover it down to where they now belong
+    void cascade();
+
+    std::array<std::array<Slot, slots_per_level>, level_count> levels_;
+    Slot overflow_;
+    std::uint64_t current_;
+    bool cascaded_ = false; // cascade() already ran for current_
+    std::size_t size_ = 0;
+    std::size_t key_bytes_ = 0;
+};
+
+#endif //TIMER_WHEEL_H
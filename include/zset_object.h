@@ -0,0 +1,84 @@
+//
+// Sorted-set value: a listpack for small zsets, hash plus skiplist beyond.
+//
+
+#ifndef ZSET_OBJECT_H
+#define ZSET_OBJECT_H
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <variant>
+#include "encoding_limits.h"
+#include "flat_hash_map.h"
+#include "listpack.h"
+#include "skiplist.h"
+
+class ZSetObject {
+public:
+    // Member -> score for O(1) score lookups, plus the skiplist for order
+    struct Sorted {
+        FlatHashMap<double> scores;
+        SkipList list;
+    };
+
+    // Formats a score the way replies print it (shortest round-trip form)
+    static std::string format_score(double score);
+    // Parses a score argument; accepts inf/+inf/-inf, rejects NaN
+    static bool parse_score(std::string_view text, double &score);
+
+    // Small zsets keep member/score pairs in one listpack sorted by score,
+    // converting to the hash and skiplist past the zset-max-listpack limits
+    const char *encoding_name() const;
+    std::size_t size() const;
+    // Approximate heap bytes held by the encoding
+    std::size_t memory_usage() const;
+    // Allocations the destructor releases: one for a packed encoding
+    std::size_t free_effort() const;
+
+    // Adds or updates a member; returns true if it is new
+    bool add(std::string_view member, double score, const EncodingLimits &limits);
+    bool remove(std::string_view member);
+    bool score(std::string_view member, double &score) const;
+    // 0-based position in ascending score order
+    bool rank(std::string_view member, std::size_t &rank) const;
+
+    // Ranks [first, last) of the members whose scores fall in `range`
+    std::pair<std::size_t, std::size_t> rank_span(const ScoreRange &range) const;
+
+    // Calls visit(member, score) for ranks start..stop inclusive, in order.
+    // The caller clamps the bounds to [0, size()).
+    template <typename Visitor>
+    void for_rank_range(std::size_t start, std::size_t stop, Visitor &&visit) const {
+        if (auto *pack = std::get_if<ListPack>(&data_)) {
+            std::size_t offset = pack->first();
+            for (std::size_t i = 0; i < start; i++) {
+                offset = pack->next(pack->next(offset));
+            }
+            for (std::size_t i = start; i <= stop; i++) {
+                std::size_t score_offset = pack->next(offset);
+                visit(pack->get(offset), listpack_score(*pack, score_offset));
+                offset = pack->next(score_offset);
+            }
+            return;
+        }
+        const SkipList::Node *node = std::get<Sorted>(data_).list.at_rank(start);
+        for (std::size_t i = start; i <= stop && node != nullptr; i++, node = node->next()) {
+            visit(std::string_view(node->member()), node->score());
+        }
+    }
+
+private:
+    static double listpack_score(const ListPack &pack, std::size_t offset);
+    // Offset of the member's entry in the listpack, or end()
+    std::size_t listpack_find(std::string_view member) const;
+    void listpack_insert(std::string_view member, double score);
+    void convert_to_sorted();
+
+    std::variant<ListPack, Sorted> data_;
+    // Heap bytes of the long member strings keyed in `scores`
+    std::size_t payload_ = 0;
+};
+
+#endif //ZSET_OBJECT_H
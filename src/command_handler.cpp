@@ -5,122 +5,420 @@
 #include <string>
 #include <algorithm>
 #include <cctype>
-#include <sstream>
-
-// Helper function to convert string to uppercase
-std::string to_upper(const std::string &input) {
-    std::string res = input;
-    std::transform(res.begin(), res.end(), res.begin(),
-                   [](unsigned char c) { return std::toupper(c); });
-    return res;
+#include <charconv>
+#include <cstdio>
+#include <limits>
+#include "perfect_hash.h"
+#include "slab_allocator.h"
+
+namespace {
+
+    template <typename T>
+    bool parse_integer(std::string_view str, T &value) {
+        const char *end = str.data() + str.size();
+        auto result = std::from_chars(str.data(), end, value);
+        return result.ec == std::errc() && result.ptr == end;
+    }
+
+}
+
+bool equals_ignore_case(std::string_view a, std::string_view b) {
+    return a.size() == b.size() &&
+           std::equal(a.begin(), a.end(), b.begin(), [](unsigned char x, unsigned char y) {
+               return std::toupper(x) == std::toupper(y);
+           });
 }
 
 // helper function to parse integer with error handling
-bool try_parse_int(const std::string &str, int &value) {
-    try {
-        value = std::stoi(str);
-        return true;
-    } catch (...) {
-        return false;
-    }
+bool try_parse_int(std::string_view str, int &value) {
+    return parse_integer(str, value);
 }
 
+bool try_parse_long_long(std::string_view str, long long &value) {
+    return parse_integer(str, value);
+}
 
-std::string handleCommand(const std::vector<std::string> &tokens, Database &db) {
-    if (tokens.empty()) {
-        return "Unknown Command";
-    }
+namespace {
 
-    const std::string& command = to_upper(tokens[0]);
+    using Tokens = CommandArgs;
+
+    // Parses a ZRANGEBYSCORE bound: a score, optionally prefixed by '(' to exclude it
+    bool try_parse_score_bound(std::string_view str, double &value, bool &exclusive) {
+        exclusive = !str.empty() && str[0] == '(';
+        return ZSetObject::parse_score(str.substr(exclusive ? 1 : 0), value);
+    }
 
     // String operations
-    if (command == "SET") {
-        if (tokens.size() < 3) {
-            return "Usage: Set <key> <value>";
+    void set_command(const Tokens &tokens, Database &db, ReplyBuilder &reply) {
+        if (tokens[2].size() >= Value::shared_string_min) {
+            db.set(tokens[1], SharedBuffer(tokens.take(2)));
+        } else {
+            db.set(tokens[1], tokens[2]);
         }
-        db.set(tokens[1], tokens[2]);
-        return "OK";
+        reply.status("OK");
     }
-    else if (command == "GET") {
-        if (tokens.size() < 2) {
-            return "Usage: GET <key>";
+
+    void get_command(const Tokens &tokens, Database &db, ReplyBuilder &reply) {
+        db.get(tokens[1], reply);
+    }
+
+    // Both hand large values to the lazy-free thread; UNLINK is kept for
+    // clients that ask for non-blocking deletes explicitly
+    void del_command(const Tokens &tokens, Database &db, ReplyBuilder &reply) {
+        if (tokens.size() == 2) {
+            reply.integer(db.del(tokens[1]) ? 1 : 0);
+        } else {
+            reply.integer(db.del(std::vector<std::string>(tokens.begin() + 1, tokens.end())));
         }
-        std::string value = db.get(tokens[1]);
-        return value.empty() ? "NULL" : value;
     }
-    else if (command == "DEL") {
-        if (tokens.size() < 2) {
-            return "Usage: DEL <key>";
+
+    // List operations
+    void lpush_command(const Tokens &tokens, Database &db, ReplyBuilder &reply) {
+        reply.integer(db.lpush(tokens[1], std::vector<std::string>(tokens.begin() + 2, tokens.end())));
+    }
+
+    void rpush_command(const Tokens &tokens, Database &db, ReplyBuilder &reply) {
+        reply.integer(db.rpush(tokens[1], std::vector<std::string>(tokens.begin() + 2, tokens.end())));
+    }
+
+    void lpop_command(const Tokens &tokens, Database &db, ReplyBuilder &reply) {
+        db.lpop(tokens[1], reply);
+    }
+
+    void rpop_command(const Tokens &tokens, Database &db, ReplyBuilder &reply) {
+        db.rpop(tokens[1], reply);
+    }
+
+    void lrange_command(const Tokens &tokens, Database &db, ReplyBuilder &reply) {
+        int start, end;
+        if (!try_parse_int(tokens[2], start) || !try_parse_int(tokens[3], end)) {
+            reply.error("ERR Invalid range values");
+            return;
+        }
+        db.lrange(tokens[1], start, end, reply);
+    }
+
+    // Hash operations
+    void hset_command(const Tokens &tokens, Database &db, ReplyBuilder &reply) {
+        if (tokens.size() % 2 != 0) {
+            reply.error("ERR Usage: HSET <key> <field> <value> [field value ...]");
+            return;
+        }
+        std::vector<std::pair<std::string, std::string>> pairs;
+        pairs.reserve((tokens.size() - 2) / 2);
+        for (std::size_t i = 2; i < tokens.size(); i += 2) {
+            pairs.emplace_back(tokens[i], tokens[i + 1]);
         }
-        return db.del(tokens[1]) ? "OK" : "ERROR";
+        reply.integer(db.hset(tokens[1], pairs));
+    }
+
+    void hget_command(const Tokens &tokens, Database &db, ReplyBuilder &reply) {
+        db.hget(tokens[1], tokens[2], reply);
+    }
+
+    void hmget_command(const Tokens &tokens, Database &db, ReplyBuilder &reply) {
+        db.hmget(tokens[1], std::vector<std::string_view>(tokens.begin() + 2, tokens.end()), reply);
+    }
+
+    void hdel_command(const Tokens &tokens, Database &db, ReplyBuilder &reply) {
+        reply.integer(db.hdel(tokens[1], std::vector<std::string>(tokens.begin() + 2, tokens.end())));
+    }
+
+    void hgetall_command(const Tokens &tokens, Database &db, ReplyBuilder &reply) {
+        db.hgetall(tokens[1], reply);
     }
-    // List operstions
-    else if (command == "LPUSH") {
-        if (tokens.size() < 3) {
-            return "Usage: LPUSH <key> <value> [value ...]";
+
+    void hincrby_command(const Tokens &tokens, Database &db, ReplyBuilder &reply) {
+        long long increment, result;
+        if (!try_parse_long_long(tokens[3], increment)) {
+            reply.error("ERR Value is not a valid integer or out of range");
+            return;
+        }
+        if (!db.hincrby(tokens[1], tokens[2], increment, result)) {
+            reply.error("ERR hash value is not an integer or out of range");
+            return;
         }
-        std::vector<std::string> values(tokens.begin() + 2, tokens.end());
-        return std::to_string(db.lpush(tokens[1], values));
+        reply.integer(result);
+    }
+
+    // Set operations
+    void sadd_command(const Tokens &tokens, Database &db, ReplyBuilder &reply) {
+        reply.integer(db.sadd(tokens[1], std::set<std::string>(tokens.begin() + 2, tokens.end())));
+    }
+
+    void srem_command(const Tokens &tokens, Database &db, ReplyBuilder &reply) {
+        reply.integer(db.srem(tokens[1], std::set<std::string>(tokens.begin() + 2, tokens.end())));
+    }
+
+    void sismember_command(const Tokens &tokens, Database &db, ReplyBuilder &reply) {
+        reply.integer(db.sismember(tokens[1], tokens[2]) ? 1 : 0);
+    }
+
+    void smembers_command(const Tokens &tokens, Database &db, ReplyBuilder &reply) {
+        db.smembers(tokens[1], reply);
+    }
+
+    void scard_command(const Tokens &tokens, Database &db, ReplyBuilder &reply) {
+        reply.integer(db.scard(tokens[1]));
     }
-    else if (command == "RPUSH") {
-        if (tokens.size() < 3) {
-            return "Usage: RPUSH <key> <value> [value ...]";
+
+    // Sorted set operations
+    void zadd_command(const Tokens &tokens, Database &db, ReplyBuilder &reply) {
+        if (tokens.size() % 2 != 0) {
+            reply.error("ERR Usage: ZADD <key> <score> <member> [score member ...]");
+            return;
         }
-        std::vector<std::string> values(tokens.begin() + 2, tokens.end());
-        return std::to_string(db.rpush(tokens[1], values));
+        std::vector<std::pair<double, std::string>> entries;
+        entries.reserve((tokens.size() - 2) / 2);
+        for (std::size_t i = 2; i < tokens.size(); i += 2) {
+            double score;
+            if (!ZSetObject::parse_score(tokens[i], score)) {
+                reply.error("ERR value is not a valid float");
+                return;
+            }
+            entries.emplace_back(score, tokens[i + 1]);
+        }
+        reply.integer(db.zadd(tokens[1], entries));
     }
-    else if (command == "LPOP") {
-        if (tokens.size() < 2) {
-            return "Usage: LPOP <key>";
+
+    void zrem_command(const Tokens &tokens, Database &db, ReplyBuilder &reply) {
+        reply.integer(db.zrem(tokens[1], std::vector<std::string>(tokens.begin() + 2, tokens.end())));
+    }
+
+    void zscore_command(const Tokens &tokens, Database &db, ReplyBuilder &reply) {
+        double score;
+        if (db.zscore(tokens[1], tokens[2], score)) {
+            reply.bulk(ZSetObject::format_score(score));
+        } else {
+            reply.null();
         }
-        return db.lpop(tokens[1]);
     }
-    else if (command == "RPOP") {
-        if (tokens.size() < 2) {
-            return "Usage: RPOP <key>";
+
+    void zrank_command(const Tokens &tokens, Database &db, ReplyBuilder &reply) {
+        long long rank;
+        if (db.zrank(tokens[1], tokens[2], rank)) {
+            reply.integer(rank);
+        } else {
+            reply.null();
         }
-        return db.rpop(tokens[1]);
     }
-    else if (command == "LRANGE") {
-        if (tokens.size() < 4) {
-            return "Usage: LRANGE <key> <start> <end>";
+
+    void zcard_command(const Tokens &tokens, Database &db, ReplyBuilder &reply) {
+        reply.integer(db.zcard(tokens[1]));
+    }
+
+    void zrange_command(const Tokens &tokens, Database &db, ReplyBuilder &reply) {
+        if (tokens.size() > 5 || (tokens.size() == 5 && !equals_ignore_case(tokens[4], "WITHSCORES"))) {
+            reply.error("ERR Usage: ZRANGE <key> <start> <stop> [WITHSCORES]");
+            return;
         }
-        int start, end;
-        if (!try_parse_int(tokens[2], start) || !try_parse_int(tokens[3], end)) {
-            return "Invalid range values";
+        long long start, stop;
+        if (!try_parse_long_long(tokens[2], start) || !try_parse_long_long(tokens[3], stop)) {
+            reply.error("ERR Value is not a valid integer or out of range");
+            return;
         }
-        std::vector<std::string> result = db.lrange(tokens[1], start, end);
-        std::ostringstream oss;
-        for (const auto &item : result) {
-            oss << item << " ";
+        db.zrange(tokens[1], start, stop, tokens.size() == 5, reply);
+    }
+
+    void zrangebyscore_command(const Tokens &tokens, Database &db, ReplyBuilder &reply) {
+        ScoreRange range;
+        if (!try_parse_score_bound(tokens[2], range.min, range.min_exclusive) ||
+            !try_parse_score_bound(tokens[3], range.max, range.max_exclusive)) {
+            reply.error("ERR min or max is not a float");
+            return;
+        }
+        bool with_scores = false;
+        long long offset = 0, count = -1;
+        for (std::size_t i = 4; i < tokens.size(); i++) {
+            if (equals_ignore_case(tokens[i], "WITHSCORES")) {
+                with_scores = true;
+            } else if (equals_ignore_case(tokens[i], "LIMIT") && i + 2 < tokens.size() &&
+                       try_parse_long_long(tokens[i + 1], offset) && try_parse_long_long(tokens[i + 2], count)) {
+                i += 2;
+            } else {
+                reply.error("ERR Usage: ZRANGEBYSCORE <key> <min> <max> [WITHSCORES] [LIMIT offset count]");
+                return;
+            }
         }
-        return oss.str();
+        db.zrangebyscore(tokens[1], range, with_scores, offset, count, reply);
     }
+
     // Key operations
-    else if (command == "EXISTS") {
-        if (tokens.size() < 2) {
-            return "Usage: EXISTS <key>";
+    void exists_command(const Tokens &tokens, Database &db, ReplyBuilder &reply) {
+        if (tokens.size() == 2) {
+            reply.integer(db.exists(tokens[1]) ? 1 : 0);
+        } else {
+            reply.integer(db.exists(std::vector<std::string>(tokens.begin() + 1, tokens.end())));
         }
-        return db.exists(tokens[1]) ? "OK" : "NOT EXISTS";
     }
-    else if (command == "EXPIRE") {
-        if (tokens.size() < 3) {
-            return "Usage: EXPIRE <key> <seconds>";
+
+    // EXPIRE, PEXPIRE and PEXPIREAT. The argument times `scale` is a TTL or
+    // Unix time in milliseconds; one the clock cannot represent is refused
+    template <bool (Database::*apply)(std::string_view, long long), bool (*fits)(long long), long long scale>
+    void expire_command(const Tokens &tokens, Database &db, ReplyBuilder &reply) {
+        long long value;
+        if (!try_parse_long_long(tokens[2], value)) {
+            reply.error("ERR Value is not a valid integer or out of range");
+            return;
         }
-        int seconds;
-        if (!try_parse_int(tokens[2], seconds) || seconds < 0) {
-            return "Value is not a valid integer or out of range";
+        constexpr long long limit = std::numeric_limits<long long>::max() / scale;
+        if (value > limit || value < -limit || !fits(value * scale)) {
+            std::string message = "ERR invalid expire time in '";
+            for (char c : tokens[0]) {
+                message += static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+            }
+            reply.error(message + "' command");
+            return;
         }
-        return db.expire(tokens[1], seconds) ? "OK" : "ERROR";
+        reply.integer((db.*apply)(tokens[1], value * scale) ? 1 : 0);
+    }
+
+    void ttl_command(const Tokens &tokens, Database &db, ReplyBuilder &reply) {
+        reply.integer(db.ttl(tokens[1]));
     }
-    else if (command == "TTL") {
-        if (tokens.size() < 2) {
-            return "Usage: TTL <key>";
+
+    void pttl_command(const Tokens &tokens, Database &db, ReplyBuilder &reply) {
+        reply.integer(db.pttl(tokens[1]));
+    }
+
+    void object_command(const Tokens &tokens, Database &db, ReplyBuilder &reply) {
+        if (!equals_ignore_case(tokens[1], "ENCODING")) {
+            reply.error("ERR Usage: OBJECT ENCODING <key>");
+            return;
         }
-        return std::to_string(db.ttl(tokens[1]));
+        std::string encoding = db.object_encoding(tokens[2]);
+        if (encoding.empty()) {
+            reply.null();
+        } else {
+            reply.bulk(encoding);
+        }
+    }
+
+    void flushall_command(const Tokens &tokens, Database &db, ReplyBuilder &reply) {
+        bool async = tokens.size() > 1 && equals_ignore_case(tokens[1], "ASYNC");
+        if (tokens.size() > 2 || (tokens.size() == 2 && !async && !equals_ignore_case(tokens[1], "SYNC"))) {
+            reply.error("ERR Usage: FLUSHALL [ASYNC|SYNC]");
+            return;
+        }
+        db.flushall(async);
+        reply.status("OK");
+    }
+
+    void info_command(const Tokens &tokens, Database &db, ReplyBuilder &reply) {
+        // Only the memory section exists; other sections come back empty
+        std::string_view section = tokens.size() > 1 ? tokens[1] : "default";
+        std::string info;
+        if (equals_ignore_case(section, "MEMORY") || equals_ignore_case(section, "DEFAULT") ||
+            equals_ignore_case(section, "ALL") || equals_ignore_case(section, "EVERYTHING")) {
+            SlabAllocator::Stats slab = SlabAllocator::stats();
+            char ratio[32];
+            std::snprintf(ratio, sizeof(ratio), "%.2f", slab.fragmentation_ratio());
+            info = "# Memory\r\n"
+                   "used_memory:" + std::to_string(db.used_memory()) + "\r\n"
+                   "maxmemory:" + std::to_string(db.maxmemory_limit()) + "\r\n"
+                   "maxmemory_policy:" + Database::eviction_policy_name(db.maxmemory_policy()) + "\r\n"
+                   "slab_reserved:" + std::to_string(slab.reserved) + "\r\n"
+                   "slab_allocated:" + std::to_string(slab.allocated) + "\r\n"
+                   "slab_requested:" + std::to_string(slab.requested) + "\r\n"
+                   "slab_fragmentation_ratio:" + ratio + "\r\n";
+        }
+        reply.bulk(info);
+    }
+
+    void ping_command(const Tokens &tokens, Database &, ReplyBuilder &reply) {
+        if (tokens.size() > 1) {
+            reply.bulk(tokens[1]);
+        } else {
+            reply.status("PONG");
+        }
+    }
+
+    // name, handler, arity, flags, first key, last key, key step, usage
+    constexpr CommandSpec commands[] = {
+        {"SET", set_command, -3, command_write | command_denyoom, 1, 1, 1, "ERR Usage: Set <key> <value>"},
+        {"GET", get_command, -2, command_readonly, 1, 1, 1, "ERR Usage: GET <key>"},
+        {"DEL", del_command, -2, command_write, 1, -1, 1, "ERR Usage: DEL <key> [key ...]"},
+        {"UNLINK", del_command, -2, command_write, 1, -1, 1, "ERR Usage: UNLINK <key> [key ...]"},
+        {"LPUSH", lpush_command, -3, command_write | command_denyoom, 1, 1, 1, "ERR Usage: LPUSH <key> <value> [value ...]"},
+        {"RPUSH", rpush_command, -3, command_write | command_denyoom, 1, 1, 1, "ERR Usage: RPUSH <key> <value> [value ...]"},
+        {"LPOP", lpop_command, -2, command_write, 1, 1, 1, "ERR Usage: LPOP <key>"},
+        {"RPOP", rpop_command, -2, command_write, 1, 1, 1, "ERR Usage: RPOP <key>"},
+        {"LRANGE", lrange_command, -4, command_readonly, 1, 1, 1, "ERR Usage: LRANGE <key> <start> <end>"},
+        {"HSET", hset_command, -4, command_write | command_denyoom, 1, 1, 1, "ERR Usage: HSET <key> <field> <value> [field value ...]"},
+        {"HGET", hget_command, -3, command_readonly, 1, 1, 1, "ERR Usage: HGET <key> <field>"},
+        {"HMGET", hmget_command, -3, command_readonly, 1, 1, 1, "ERR Usage: HMGET <key> <field> [field ...]"},
+        {"HDEL", hdel_command, -3, command_write, 1, 1, 1, "ERR Usage: HDEL <key> <field> [field ...]"},
+        {"HGETALL", hgetall_command, -2, command_readonly, 1, 1, 1, "ERR Usage: HGETALL <key>"},
+        {"HINCRBY", hincrby_command, -4, command_write | command_denyoom, 1, 1, 1, "ERR Usage: HINCRBY <key> <field> <increment>"},
+        {"SADD", sadd_command, -3, command_write | command_denyoom, 1, 1, 1, "ERR Usage: SADD <key> <member> [member ...]"},
+        {"SREM", srem_command, -3, command_write, 1, 1, 1, "ERR Usage: SREM <key> <member> [member ...]"},
+        {"SISMEMBER", sismember_command, -3, command_readonly, 1, 1, 1, "ERR Usage: SISMEMBER <key> <member>"},
+        {"SMEMBERS", smembers_command, -2, command_readonly, 1, 1, 1, "ERR Usage: SMEMBERS <key>"},
+        {"SCARD", scard_command, -2, command_readonly, 1, 1, 1, "ERR Usage: SCARD <key>"},
+        {"ZADD", zadd_command, -4, command_write | command_denyoom, 1, 1, 1, "ERR Usage: ZADD <key> <score> <member> [score member ...]"},
+        {"ZREM", zrem_command, -3, command_write, 1, 1, 1, "ERR Usage: ZREM <key> <member> [member ...]"},
+        {"ZSCORE", zscore_command, -3, command_readonly, 1, 1, 1, "ERR Usage: ZSCORE <key> <member>"},
+        {"ZRANK", zrank_command, -3, command_readonly, 1, 1, 1, "ERR Usage: ZRANK <key> <member>"},
+        {"ZCARD", zcard_command, -2, command_readonly, 1, 1, 1, "ERR Usage: ZCARD <key>"},
+        {"ZRANGE", zrange_command, -4, command_readonly, 1, 1, 1, "ERR Usage: ZRANGE <key> <start> <stop> [WITHSCORES]"},
+        {"ZRANGEBYSCORE", zrangebyscore_command, -4, command_readonly, 1, 1, 1,
+         "ERR Usage: ZRANGEBYSCORE <key> <min> <max> [WITHSCORES] [LIMIT offset count]"},
+        {"EXISTS", exists_command, -2, command_readonly, 1, -1, 1, "ERR Usage: EXISTS <key> [key ...]"},
+        {"EXPIRE", expire_command<&Database::pexpire, &Database::ttl_fits, 1000>, -3, command_write, 1, 1, 1, "ERR Usage: EXPIRE <key> <seconds>"},
+        {"PEXPIRE", expire_command<&Database::pexpire, &Database::ttl_fits, 1>, -3, command_write, 1, 1, 1,
+         "ERR Usage: PEXPIRE <key> <milliseconds>"},
+        {"PEXPIREAT", expire_command<&Database::pexpireat, &Database::unix_deadline_fits, 1>, -3, command_write, 1, 1, 1,
+         "ERR Usage: PEXPIREAT <key> <unix-time-milliseconds>"},
+        {"TTL", ttl_command, -2, command_readonly, 1, 1, 1, "ERR Usage: TTL <key>"},
+        {"PTTL", pttl_command, -2, command_readonly, 1, 1, 1, "ERR Usage: PTTL <key>"},
+        {"OBJECT", object_command, -3, command_readonly, 2, 2, 1, "ERR Usage: OBJECT ENCODING <key>"},
+        {"FLUSHALL", flushall_command, -1, command_write | command_all_shards, 0, 0, 0, "ERR Usage: FLUSHALL [ASYNC|SYNC]"},
+        {"INFO", info_command, -1, 0, 0, 0, 0, "ERR Usage: INFO [section]"},
+        {"PING", ping_command, -1, 0, 0, 0, 0, "ERR Usage: PING [message]"},
+    };
+
+    constexpr auto command_index = perfect_hash::build<128>(commands);
+    static_assert(command_index.valid, "no collision-free seed for the command table");
+
+}
+
+std::string CommandArgs::take(std::size_t index) const {
+    if (payload_ != nullptr && tokens_[index].data() == payload_->data()) {
+        return std::move(*payload_);
+    }
+    return std::string(tokens_[index]);
+}
+
+const CommandSpec *find_command(std::string_view name) {
+    std::size_t position = command_index.find(name, commands);
+    return position == command_index.npos ? nullptr : &commands[position];
+}
+
+void handleCommand(const std::vector<std::string_view> &tokens, Database &db, ReplyBuilder &reply) {
+    handleCommand(CommandArgs(tokens), db, reply);
+}
+
+void handleCommand(const CommandArgs &tokens, Database &db, ReplyBuilder &reply) {
+    if (tokens.empty()) {
+        reply.error("ERR Unknown Command");
+        return;
+    }
+
+    const CommandSpec *command = find_command(tokens[0]);
+    if (command == nullptr) {
+        std::string name(tokens[0]);
+        std::transform(name.begin(), name.end(), name.begin(),
+                       [](unsigned char c) { return std::toupper(c); });
+        reply.error("ERR Unknown Command: " + name);
+        return;
+    }
+    if (!command->arity_ok(tokens.size())) {
+        reply.error(command->usage);
+        return;
     }
-    else if (command == "PING") {
-        return "PONG";
+    if (command->has(command_denyoom) && !db.free_memory_if_needed()) {
+        reply.error("OOM command not allowed when used memory > 'maxmemory'.");
+        return;
     }
-    return "Unknown Command: " + command;
+    command->handler(tokens, db, reply);
 }
@@ -3,15 +3,239 @@
 //
 
 #include "command_parser.h"
-#include <sstream>
 
-std::vector<std::string> parseCommand(const std::string& input) {
-    std::vector<std::string> tokens;
-    std::istringstream iss(input);
-    std::string token;
+namespace {
 
-    while (iss >> token) {
-        tokens.push_back(token);
+    ParseResult incomplete() {
+        return {};
     }
-    return tokens;
-}
\ No newline at end of file
+
+    // Keeps the arguments' capacity for the next request
+    void reset(ParseState &state) {
+        state.pos = 0;
+        state.count = 0;
+        state.arguments.clear();
+    }
+
+    ParseResult error(std::string_view message) {
+        ParseResult result;
+        result.status = ParseStatus::Error;
+        result.protocol = Protocol::Resp;
+        result.error = message;
+        return result;
+    }
+
+    // Reads a "<integer>\r\n" line starting at `pos`. On success `pos` is moved
+    // past the CRLF. Returns Incomplete if the line has not fully arrived yet.
+    ParseStatus read_length(std::string_view input, std::size_t &pos, long long &value) {
+        std::size_t end = input.find('\r', pos);
+        if (end == std::string_view::npos || end + 1 >= input.size()) {
+            // Guard against a client streaming an endless header
+            return input.size() - pos > 32 ? ParseStatus::Error : ParseStatus::Incomplete;
+        }
+        if (input[end + 1] != '\n' || end == pos) {
+            return ParseStatus::Error;
+        }
+
+        bool negative = false;
+        std::size_t i = pos;
+        if (input[i] == '-') {
+            negative = true;
+            ++i;
+        }
+        if (i == end) {
+            return ParseStatus::Error;
+        }
+        long long n = 0;
+        for (; i < end; ++i) {
+            char c = input[i];
+            if (c < '0' || c > '9' || n > (max_bulk_length * 10)) {
+                return ParseStatus::Error;
+            }
+            n = n * 10 + (c - '0');
+        }
+        value = negative ? -n : n;
+        pos = end + 2;
+        return ParseStatus::Complete;
+    }
+
+    ParseResult parse_inline(std::string_view input, std::vector<std::string_view> &tokens, ParseState &state) {
+        std::size_t newline = input.find('\n', state.pos);
+        if (newline == std::string_view::npos) {
+            if (input.size() > max_inline_length) {
+                ParseResult result = error("Protocol error: too big inline request");
+                result.protocol = Protocol::Inline;
+                return result;
+            }
+            state.pos = input.size();
+            return incomplete();
+        }
+
+        std::string_view line = input.substr(0, newline);
+        if (!line.empty() && line.back() == '\r') {
+            line.remove_suffix(1);
+        }
+
+        std::size_t pos = 0;
+        while (pos < line.size()) {
+            while (pos < line.size() && (line[pos] == ' ' || line[pos] == '\t')) {
+                ++pos;
+            }
+            std::size_t start = pos;
+            while (pos < line.size() && line[pos] != ' ' && line[pos] != '\t') {
+                ++pos;
+            }
+            if (pos > start) {
+                tokens.push_back(line.substr(start, pos - start));
+            }
+        }
+
+        ParseResult result;
+        result.status = ParseStatus::Complete;
+        result.protocol = Protocol::Inline;
+        result.consumed = newline + 1;
+        return result;
+    }
+
+    // Records the arguments this call parsed, which it leaves out of `tokens`,
+    // and where the next call should pick up
+    ParseResult suspend(ParseResult result, std::string_view input, std::vector<std::string_view> &tokens,
+                        std::size_t pos, ParseState &state) {
+        for (std::string_view token : tokens) {
+            state.arguments.emplace_back(static_cast<std::size_t>(token.data() - input.data()), token.size());
+        }
+        tokens.clear();
+        state.pos = pos;
+        return result;
+    }
+
+    // Carries on from `state`: the count and the arguments already parsed are
+    // not looked at again. With `last`, the final argument's bytes are not in
+    // `input`: its header must end at `head`, be followed by the CRLF, and
+    // announce last->size()
+    ParseResult parse_multibulk(std::string_view input, std::vector<std::string_view> &tokens, ParseState &state,
+                                const std::string_view *last = nullptr, std::size_t head = 0) {
+        std::size_t pos = state.pos;
+        if (pos == 0) {
+            pos = 1; // skip '*'
+            ParseStatus status = read_length(input, pos, state.count);
+            if (status == ParseStatus::Incomplete) {
+                return incomplete();
+            }
+            if (status == ParseStatus::Error || state.count > max_multibulk_length) {
+                return error("Protocol error: invalid multibulk length");
+            }
+        }
+
+        long long count = state.count;
+        for (auto i = static_cast<long long>(state.arguments.size()); i < count; ++i) {
+            std::size_t header = pos;
+            if (pos >= input.size()) {
+                return suspend(incomplete(), input, tokens, header, state);
+            }
+            if (input[pos] != '$') {
+                return error("Protocol error: expected '$'");
+            }
+            ++pos;
+
+            long long length = 0;
+            ParseStatus status = read_length(input, pos, length);
+            if (status == ParseStatus::Incomplete) {
+                return suspend(incomplete(), input, tokens, header, state);
+            }
+            if (status == ParseStatus::Error || length < 0 || length > max_bulk_length) {
+                return error("Protocol error: invalid bulk length");
+            }
+
+            auto size = static_cast<std::size_t>(length);
+            if (last != nullptr && i + 1 == count) {
+                if (pos != head || size != last->size()) {
+                    return error("Protocol error: invalid bulk length");
+                }
+                if (input.size() - pos < 2) {
+                    return suspend(incomplete(), input, tokens, header, state);
+                }
+                if (input[pos] != '\r' || input[pos + 1] != '\n') {
+                    return error("Protocol error: bulk string not terminated by CRLF");
+                }
+                tokens.push_back(*last);
+                pos += 2;
+                break;
+            }
+            if (input.size() - pos < size + 2) {
+                ParseResult result = incomplete();
+                result.pending_bulk_offset = pos;
+                result.pending_bulk_length = size;
+                result.pending_bulk_last = i + 1 == count;
+                return suspend(result, input, tokens, header, state);
+            }
+            if (input[pos + size] != '\r' || input[pos + size + 1] != '\n') {
+                return error("Protocol error: bulk string not terminated by CRLF");
+            }
+            tokens.push_back(input.substr(pos, size));
+            pos += size + 2;
+        }
+
+        // Put the arguments earlier calls parsed in front of this call's
+        if (!state.arguments.empty()) {
+            tokens.insert(tokens.begin(), state.arguments.size(), std::string_view());
+            for (std::size_t i = 0; i < state.arguments.size(); ++i) {
+                tokens[i] = input.substr(state.arguments[i].first, state.arguments[i].second);
+            }
+        }
+
+        ParseResult result;
+        result.status = ParseStatus::Complete;
+        result.protocol = Protocol::Resp;
+        result.consumed = pos;
+        return result;
+    }
+}
+
+ParseResult parseCommand(std::string_view input, std::vector<std::string_view> &tokens, ParseState &state) {
+    tokens.clear();
+    if (input.empty()) {
+        return incomplete();
+    }
+
+    ParseResult result = input[0] == '*' ? parse_multibulk(input, tokens, state) : parse_inline(input, tokens, state);
+    if (result.status != ParseStatus::Incomplete) {
+        reset(state);
+    }
+    if (result.status != ParseStatus::Complete) {
+        tokens.clear();
+    }
+    return result;
+}
+
+ParseResult parseCommand(std::string_view input, std::vector<std::string_view> &tokens) {
+    ParseState state;
+    return parseCommand(input, tokens, state);
+}
+
+ParseResult parseCommandWithLast(std::string_view input, std::size_t head, std::string_view last,
+                                 std::vector<std::string_view> &tokens, ParseState &state) {
+    tokens.clear();
+    if (input.empty() || input[0] != '*') {
+        reset(state);
+        return error("Protocol error: expected '*'");
+    }
+    ParseResult result = parse_multibulk(input, tokens, state, &last, head);
+    if (result.status == ParseStatus::Complete && (tokens.empty() || tokens.back().data() != last.data())) {
+        // The request ended before reaching `head`
+        result = error("Protocol error: invalid multibulk length");
+    }
+    if (result.status != ParseStatus::Incomplete) {
+        reset(state);
+    }
+    if (result.status != ParseStatus::Complete) {
+        tokens.clear();
+    }
+    return result;
+}
+
+ParseResult parseCommandWithLast(std::string_view input, std::size_t head, std::string_view last,
+                                 std::vector<std::string_view> &tokens) {
+    ParseState state;
+    return parseCommandWithLast(input, head, last, tokens, state);
+}
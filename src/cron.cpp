@@ -0,0 +1,33 @@
+//
+// Periodic housekeeping run on an event loop, in the spirit of Redis' serverCron.
+//
+
+#include "cron.h"
+
+Cron::Cron(boost::asio::io_context &io_context, Database &db)
+    : timer_(io_context), db_(db) {
+    schedule();
+}
+
+void Cron::schedule() {
+    timer_.expires_after(expire_backlog_ ? std::chrono::milliseconds(fast_interval) : interval);
+    timer_.async_wait([this](boost::system::error_code ec) {
+        if (!ec) {
+            tick();
+            schedule();
+        }
+    });
+}
+
+void Cron::tick() {
+    auto now = std::chrono::steady_clock::now();
+    if (now - last_tick_ < interval) {
+        // A fast cycle between regular ticks only works on the expiry backlog
+        expire_backlog_ = db_.cleanup_expired_keys(fast_expire_budget);
+        return;
+    }
+    last_tick_ = now;
+    db_.update_clock();
+    db_.incremental_rehash(rehash_budget);
+    expire_backlog_ = db_.cleanup_expired_keys(expire_budget);
+}
@@ -2,221 +2,1535 @@
 // Created by kushal bang on 05-03-2025.
 //
 #include "database.h"
+#include "lazy_free.h"
+#include "memory_usage.h"
+#include "slab_allocator.h"
+#include <algorithm>
+#include <charconv>
+#include <climits>
+#include <cstdint>
+#include <limits>
+#include <new>
+#include <utility>
 
-bool Database::check_or_create_type(const std::string &key, DataType type) {
+namespace {
+
+    const std::pair<const char *, EvictionPolicy> eviction_policy_names[] = {
+        {"noeviction", EvictionPolicy::NoEviction},
+        {"allkeys-lru", EvictionPolicy::AllKeysLru},
+        {"allkeys-lfu", EvictionPolicy::AllKeysLfu},
+        {"volatile-lru", EvictionPolicy::VolatileLru},
+        {"volatile-ttl", EvictionPolicy::VolatileTtl},
+    };
+
+    std::minstd_rand &thread_rng() {
+        thread_local std::minstd_rand rng(std::random_device{}());
+        return rng;
+    }
+
+    // Resolves LRANGE's indexes (negative ones count from the end) against a
+    // list of `size` elements; false if the range selects nothing
+    bool clamp_list_range(int size, int &start, int &end) {
+        int orig_start = start;
+        int orig_end = end;
+        if (start < 0) {
+            start = std::max(0, size + start);
+        }
+        if (end < 0) {
+            end = std::max(0, size + end);
+        }
+        if (start == end && orig_start < 0 && orig_end < 0 && -orig_start > size && -orig_end > size) {
+            return false;
+        }
+        if (start > end || start >= size) {
+            return false;
+        }
+        end = std::min(end, size - 1);
+        return true;
+    }
+
+}
+
+Value::Value(std::string_view str) : type_(DataType::STRING) {
+    if (str.size() >= shared_string_min) {
+        new (&blob_) SharedBuffer(std::string(str));
+        shared_ = true;
+    } else {
+        new (&str_) SlabString(str);
+    }
+}
+
+Value::Value(SharedBuffer blob) : type_(DataType::STRING), shared_(true) {
+    new (&blob_) SharedBuffer(std::move(blob));
+}
+
+Value::Value(DataType type) : type_(type) {
+    switch (type) {
+        case DataType::STRING:
+            new (&str_) SlabString();
+            break;
+        case DataType::LIST:
+            list_ = slab_new<List>();
+            break;
+        case DataType::HASH:
+            hash_ = slab_new<Hash>();
+            break;
+        case DataType::SET:
+            set_ = slab_new<Set>();
+            break;
+        case DataType::ZSET:
+            zset_ = slab_new<ZSet>();
+            break;
+    }
+}
+
+Value::Value(Value &&other) noexcept : type_(other.type_), shared_(other.shared_), access_(other.access()) {
+    take(other);
+}
+
+Value &Value::operator=(Value &&other) noexcept {
+    if (this != &other) {
+        reset();
+        type_ = other.type_;
+        shared_ = other.shared_;
+        take(other);
+        set_access(other.access());
+    }
+    return *this;
+}
+
+void Value::reset() {
+    switch (type_) {
+        case DataType::STRING:
+            if (shared_) {
+                blob_.~SharedBuffer();
+            } else {
+                str_.~basic_string();
+            }
+            break;
+        case DataType::LIST:
+            slab_delete(list_);
+            break;
+        case DataType::HASH:
+            slab_delete(hash_);
+            break;
+        case DataType::SET:
+            slab_delete(set_);
+            break;
+        case DataType::ZSET:
+            slab_delete(zset_);
+            break;
+    }
+}
+
+void Value::take(Value &other) {
+    // A moved-from container value holds nullptr and may only be destroyed
+    switch (type_) {
+        case DataType::STRING:
+            if (shared_) {
+                new (&blob_) SharedBuffer(std::move(other.blob_));
+            } else {
+                new (&str_) SlabString(std::move(other.str_));
+            }
+            break;
+        case DataType::LIST:
+            list_ = std::exchange(other.list_, nullptr);
+            break;
+        case DataType::HASH:
+            hash_ = std::exchange(other.hash_, nullptr);
+            break;
+        case DataType::SET:
+            set_ = std::exchange(other.set_, nullptr);
+            break;
+        case DataType::ZSET:
+            zset_ = std::exchange(other.zset_, nullptr);
+            break;
+    }
+}
+
+std::size_t Value::memory_usage() const {
+    switch (type_) {
+        case DataType::STRING:
+            return shared_ ? blob_.memory_usage() : string_heap_bytes(str_.capacity());
+        case DataType::LIST:
+            return sizeof(List) + list_->memory_usage();
+        case DataType::HASH:
+            return sizeof(Hash) + hash_->memory_usage();
+        case DataType::SET:
+            return sizeof(Set) + set_->memory_usage();
+        case DataType::ZSET:
+            return sizeof(ZSet) + zset_->memory_usage();
+    }
+    return 0;
+}
+
+bool Value::string_on_heap() const {
+    if (shared_) {
+        return true;
+    }
+    auto *object = reinterpret_cast<const char *>(&str_);
+    return str_.data() < object || str_.data() >= object + sizeof(str_);
+}
+
+std::size_t Value::free_effort() const {
+    switch (type_) {
+        case DataType::STRING:
+            return 1;
+        case DataType::LIST:
+            return list_->free_effort();
+        case DataType::HASH:
+            return hash_->free_effort();
+        case DataType::SET:
+            return set_->free_effort();
+        case DataType::ZSET:
+            return zset_->free_effort();
+    }
+    return 1;
+}
+
+Database::Database(bool synchronized)
+    : stripes(new Stripe[stripe_count]), synchronized(synchronized), eviction_rng(std::random_device{}()) {
+    update_clock();
+}
+
+std::uint64_t Database::wheel_tick(std::chrono::steady_clock::time_point time) {
+    return static_cast<std::uint64_t>(
+        std::chrono::duration_cast<std::chrono::milliseconds>(time.time_since_epoch()).count());
+}
+
+Database::Stripe &Database::stripe_for(std::string_view key) {
+    // Take the top bits of a mixed hash, the containers use the low ones
+    std::size_t hash = std::hash<std::string_view>{}(key);
+    return stripes[(static_cast<std::uint64_t>(hash) * 0x9E3779B97F4A7C15ULL) >> (64 - stripe_bits)];
+}
+
+Database::WriteLock Database::lock_stripe(Stripe &stripe) {
+    if (!synchronized) {
+        return WriteLock(stripe.mutex, std::defer_lock);
+    }
+    return WriteLock(stripe.mutex);
+}
+
+Database::ReadLock Database::lock_stripe_shared(Stripe &stripe) {
+    if (!synchronized) {
+        return ReadLock(stripe.mutex, std::defer_lock);
+    }
+    return ReadLock(stripe.mutex);
+}
+
+std::vector<Database::Stripe *> Database::stripes_for(const std::vector<std::string> &keys) {
+    std::vector<Stripe *> touched;
+    touched.reserve(keys.size());
+    for (const auto &key : keys) {
+        touched.push_back(&stripe_for(key));
+    }
+    // Stripes live in one array, so address order is a fixed global order
+    std::sort(touched.begin(), touched.end());
+    touched.erase(std::unique(touched.begin(), touched.end()), touched.end());
+    return touched;
+}
+
+bool Database::check_or_create_type(Stripe &stripe, std::string_view key, DataType type) {
+    auto &data = stripe.data;
     auto it = data.find(key);
     if (it == data.end()) {
         // Key does not exist, create a new entry with the specified type
-        Value val;
-        val.type = type;
-        data[key] = val;
+        it = data.emplace(key, Value(type)).first;
+        init_access(it->second);
+        account(stripe, 0, entry_bytes(key, it->second));
         return true;
     }
     // Key exists, check if the type matches
-    return it->second.type == type;
+    touch(it->second);
+    return it->second.type() == type;
 }
 
-bool Database::check_type(const std::string &key, DataType type) {
-    auto it = data.find(key);
-    if (it == data.end()) {
+bool Database::check_type(Stripe &stripe, std::string_view key, DataType type) {
+    auto it = stripe.data.find(key);
+    if (it == stripe.data.end()) {
         // Key does not exist
         return false;
     }
     // Key exists, check if the type matches
-    return it->second.type == type;
+    touch(it->second);
+    return it->second.type() == type;
+}
+
+bool Database::remove_key(Stripe &stripe, std::string_view key) {
+    auto it = stripe.data.find(key);
+    if (it == stripe.data.end()) {
+        return false;
+    }
+    std::size_t released = entry_bytes(key, it->second);
+    if (!stripe.expires.empty() && stripe.expires.erase(key) > 0) {
+        released += string_heap_bytes(key.size());
+    }
+    release(it->second);
+    stripe.data.erase(key);
+    account(stripe, released, 0);
+    return true;
+}
+
+void Database::release(Value &value) {
+    if (value.free_effort() > lazyfree_threshold) {
+        LazyFree::shared().free(std::move(value));
+    }
+}
+
+std::size_t Database::entry_bytes(std::string_view key, const Value &value) {
+    return string_heap_bytes(key.size()) + value.memory_usage();
 }
 
-// bool operator>(const std::chrono::system_clock::time_point & now, const std::chrono::steady_clock::time_point & rhs);
+void Database::account(Stripe &stripe, std::size_t released, std::size_t added) {
+    stripe.payload = stripe.payload - released + added;
+    stripe.used_memory.store(stripe.data.allocated_bytes() + stripe.expires.allocated_bytes() +
+                             stripe.scheduled.allocated_bytes() + (stripe.wheel ? stripe.wheel->memory_usage() : 0) +
+                             stripe.payload,
+                             std::memory_order_relaxed);
+}
 
-bool Database::is_expired(const std::string &key) {
-    auto it = data.find(key);
-    if (it != data.end() && it->second.has_expiry) {
+bool Database::is_expired(Stripe &stripe, std::string_view key) {
+    if (stripe.expires.empty()) {
+        return false;
+    }
+    auto it = stripe.expires.find(key);
+    if (it != stripe.expires.end()) {
         // If the expiry is set with steady_clock, we need to compare against steady_clock
         auto now = std::chrono::steady_clock::now();
-        if (now > it->second.expiry) {
-            data.erase(it); // Remove expired key
+        if (now > it->second) {
+            remove_key(stripe, key); // Remove expired key
+            return true;
+        }
+    }
+    return false;
+}
+
+const Value *Database::find_live(Stripe &stripe, std::string_view key, bool &expired) {
+    expired = false;
+    auto it = stripe.data.find(key);
+    if (it == stripe.data.end()) {
+        return nullptr;
+    }
+    if (!stripe.expires.empty()) {
+        auto deadline = stripe.expires.find(key);
+        if (deadline != stripe.expires.end() && std::chrono::steady_clock::now() > deadline->second) {
+            expired = true;
+            return nullptr;
+        }
+    }
+    touch(it->second);
+    return &it->second;
+}
+
+void Database::reap_expired(Stripe &stripe, std::string_view key) {
+    auto lock = lock_stripe(stripe);
+    // Re-check: the key may have been reaped or rewritten since the read lock was dropped
+    is_expired(stripe, key);
+}
+
+template <typename Read>
+bool Database::read_live(std::string_view key, Read &&read) {
+    Stripe &stripe = stripe_for(key);
+    bool expired;
+    {
+        auto lock = lock_stripe_shared(stripe);
+        const Value *value = find_live(stripe, key, expired);
+        if (value != nullptr) {
+            read(*value);
             return true;
         }
     }
+    if (expired) {
+        reap_expired(stripe, key);
+    }
     return false;
 }
 
+template <typename Take>
+bool Database::pop_element(std::string_view key, bool front, Take &&take) {
+    Stripe &stripe = stripe_for(key);
+    auto lock = lock_stripe(stripe);
+    if (is_expired(stripe, key) || !check_type(stripe, key, DataType::LIST)) {
+        return false;
+    }
+    auto &entry = stripe.data[key];
+    auto &list = entry.list_val();
+    if (list.empty()) {
+        return false;
+    }
+    std::size_t before = entry.memory_usage();
+    if (front) {
+        take(list.front());
+        list.pop_front();
+    } else {
+        take(list.back());
+        list.pop_back();
+    }
+    account(stripe, before, entry.memory_usage());
+    if (list.empty()) {
+        remove_key(stripe, key);
+    }
+    return true;
+}
+
 // String operations
-void Database::set(const std::string &key, const std::string &value) {
-    std::lock_guard lock(mutex);
-    Value val;
-    val.type = DataType::STRING;
-    val.string_val = value;
-    data[key] = val;
+void Database::set(std::string_view key, std::string_view value) {
+    set_value(key, Value(value));
 }
 
-std::string Database::get(const std::string &key) {
-    std::lock_guard lock(mutex);
-    if (is_expired(key)) {
-        return "NULL";
+void Database::set(std::string_view key, SharedBuffer value) {
+    set_value(key, Value(std::move(value)));
+}
+
+void Database::set_value(std::string_view key, Value value) {
+    Stripe &stripe = stripe_for(key);
+    auto lock = lock_stripe(stripe);
+    auto &data = stripe.data;
+    // SET replaces the value and discards any TTL
+    std::size_t released = 0;
+    if (!stripe.expires.empty() && stripe.expires.erase(key) > 0) {
+        released += string_heap_bytes(key.size());
     }
     auto it = data.find(key);
-    if (it != data.end() && it->second.type == DataType::STRING) {
-        return it->second.string_val;
+    if (it != data.end()) {
+        // An overwrite keeps the key's access history
+        released += entry_bytes(key, it->second);
+        std::uint32_t access = it->second.access();
+        release(it->second);
+        it->second = std::move(value);
+        it->second.set_access(access);
+        touch(it->second);
+    } else {
+        it = data.try_emplace(key, std::move(value)).first;
+        init_access(it->second);
+    }
+    account(stripe, released, entry_bytes(key, it->second));
+}
+
+std::string Database::get(std::string_view key) {
+    Stripe &stripe = stripe_for(key);
+    bool expired;
+    {
+        auto lock = lock_stripe_shared(stripe);
+        const Value *value = find_live(stripe, key, expired);
+        if (value != nullptr) {
+            return value->type() == DataType::STRING ? std::string(value->string_val()) : "NULL";
+        }
+    }
+    if (expired) {
+        reap_expired(stripe, key);
     }
     return "NULL";
 }
 
-bool Database::del(const std::string &key) {
-    std::lock_guard lock(mutex);
-    return data.erase(key) > 0;
+void Database::get(std::string_view key, ReplyBuilder &reply) {
+    SharedBuffer pinned;
+    bool found = read_live(key, [&](const Value &value) {
+        if (value.type() != DataType::STRING) {
+            reply.null();
+        } else if (value.is_shared_string()) {
+            // Only the reference is taken under the lock; the bytes are
+            // written after it is released, however large they are
+            pinned = value.shared_string();
+        } else {
+            reply.bulk(value.string_val());
+        }
+    });
+    if (!found) {
+        reply.null();
+    } else if (pinned) {
+        reply.bulk(pinned);
+    }
+}
+
+bool Database::del(std::string_view key) {
+    Stripe &stripe = stripe_for(key);
+    auto lock = lock_stripe(stripe);
+    return remove_key(stripe, key);
+}
+
+long long Database::del(const std::vector<std::string> &keys) {
+    auto touched = stripes_for(keys);
+    std::vector<WriteLock> locks;
+    locks.reserve(touched.size());
+    for (Stripe *stripe : touched) {
+        locks.push_back(lock_stripe(*stripe));
+    }
+
+    long long removed = 0;
+    for (const auto &key : keys) {
+        removed += remove_key(stripe_for(key), key) ? 1 : 0;
+    }
+    return removed;
+}
+
+void Database::flushall(bool async) {
+    // Everything a stripe owns, detached under its lock and destroyed after
+    struct Detached {
+        FlatHashMap<Value> data;
+        FlatHashMap<std::chrono::steady_clock::time_point> expires;
+        std::unique_ptr<TimerWheel> wheel;
+        FlatHashMap<std::uint64_t> scheduled;
+    };
+    for (std::size_t i = 0; i < stripe_count; i++) {
+        Stripe &stripe = stripes[i];
+        Detached detached;
+        {
+            auto lock = lock_stripe(stripe);
+            detached.data = std::move(stripe.data);
+            detached.expires = std::move(stripe.expires);
+            detached.wheel = std::move(stripe.wheel);
+            detached.scheduled = std::move(stripe.scheduled);
+            account(stripe, stripe.payload, 0);
+        }
+        if (async && !detached.data.empty()) {
+            LazyFree::shared().free(std::move(detached));
+        }
+    }
 }
 
 // List operations implementation (partial)
-long long Database::lpush(const std::string &key, const std::vector<std::string> &values) {
-    std::lock_guard lock(mutex);
+long long Database::lpush(std::string_view key, const std::vector<std::string> &values) {
+    Stripe &stripe = stripe_for(key);
+    auto lock = lock_stripe(stripe);
+    auto &data = stripe.data;
 
-    if (!check_or_create_type(key, DataType::LIST)) {
+    is_expired(stripe, key);
+    if (!check_or_create_type(stripe, key, DataType::LIST)) {
         return 0; // Type mismatch
     }
 
-    auto& list = data[key].list_val;
+    auto &entry = data[key];
+    std::size_t before = entry.memory_usage();
+    auto& list = entry.list_val();
     for (const auto &value : values) {
-        list.insert(list.begin(), value);
+        list.push_front(value);
     }
+    account(stripe, before, entry.memory_usage());
 
     return list.size();
 }
 
-std::string Database::lpop(const std::string &key) {
-    std::lock_guard lock(mutex);
+std::string Database::lpop(std::string_view key) {
+    std::string value = "NULL";
+    pop_element(key, true, [&value](std::string_view element) { value.assign(element); });
+    return value;
+}
 
-    if (is_expired(key)) {
-        return "NULL";
+void Database::lpop(std::string_view key, ReplyBuilder &reply) {
+    if (!pop_element(key, true, [&reply](std::string_view element) { reply.bulk(element); })) {
+        reply.null();
     }
+}
 
-    if (!check_type(key, DataType::LIST)) {
-        return "NULL"; // Type mismatch
+long long Database::rpush(std::string_view key, const std::vector<std::string> &values) {
+    Stripe &stripe = stripe_for(key);
+    auto lock = lock_stripe(stripe);
+    auto &data = stripe.data;
+
+    is_expired(stripe, key);
+    if (!check_or_create_type(stripe, key, DataType::LIST)) {
+        return 0; // Type mismatch
+    }
+    auto &entry = data[key];
+    std::size_t before = entry.memory_usage();
+    auto& list = entry.list_val();
+    for (const auto &value : values) {
+        list.push_back(value);
     }
+    account(stripe, before, entry.memory_usage());
+    return list.size();
+}
 
-    auto& list = data[key].list_val;
-    if (list.empty()) {
-        return "NULL"; // List is empty
+std::string Database::rpop(std::string_view key) {
+    std::string value = "NULL";
+    pop_element(key, false, [&value](std::string_view element) { value.assign(element); });
+    return value;
+}
+
+void Database::rpop(std::string_view key, ReplyBuilder &reply) {
+    if (!pop_element(key, false, [&reply](std::string_view element) { reply.bulk(element); })) {
+        reply.null();
     }
+}
 
-    std::string value = list.front();
-    list.erase(list.begin());
+std::vector<std::string> Database::lrange(std::string_view key, int start, int end) {
+    std::vector<std::string> result;
+    read_live(key, [&](const Value &value) {
+        if (value.type() != DataType::LIST) {
+            return; // Type mismatch
+        }
+        auto &list = value.list_val();
+        if (clamp_list_range(static_cast<int>(list.size()), start, end)) {
+            result.reserve(end - start + 1);
+            list.for_range(start, end, [&result](std::string_view item) {
+                result.emplace_back(item);
+            });
+        }
+    });
+    return result;
+}
 
-    if (list.empty()) {
-        data.erase(key);
+void Database::lrange(std::string_view key, int start, int end, ReplyBuilder &reply) {
+    bool found = read_live(key, [&](const Value &value) {
+        if (value.type() != DataType::LIST ||
+            !clamp_list_range(static_cast<int>(value.list_val().size()), start, end)) {
+            reply.array(0);
+            return;
+        }
+        reply.array(end - start + 1);
+        value.list_val().for_range(start, end, [&reply](std::string_view item) {
+            reply.bulk(item);
+        });
+    });
+    if (!found) {
+        reply.array(0);
     }
+}
 
-    return value;
+// Hash operations
+bool Database::hset(std::string_view key, std::string_view field, std::string_view value) {
+    Stripe &stripe = stripe_for(key);
+    auto lock = lock_stripe(stripe);
+
+    is_expired(stripe, key);
+    if (!check_or_create_type(stripe, key, DataType::HASH)) {
+        return false; // Type mismatch
+    }
+    auto &entry = stripe.data[key];
+    std::size_t before = entry.memory_usage();
+    bool added = entry.hash_val().set(field, value, encoding_limits);
+    account(stripe, before, entry.memory_usage());
+    return added;
 }
 
-long long Database::rpush(const std::string &key, const std::vector<std::string> &values) {
-    std::lock_guard lock(mutex);
+long long Database::hset(std::string_view key, const std::vector<std::pair<std::string, std::string>> &pairs) {
+    Stripe &stripe = stripe_for(key);
+    auto lock = lock_stripe(stripe);
 
-    if (!check_or_create_type(key, DataType::LIST)) {
+    is_expired(stripe, key);
+    if (!check_or_create_type(stripe, key, DataType::HASH)) {
         return 0; // Type mismatch
     }
-    auto& list = data[key].list_val;
-    for (const auto &value : values) {
-        list.push_back(value);
+    auto &entry = stripe.data[key];
+    std::size_t before = entry.memory_usage();
+    auto &hash = entry.hash_val();
+    long long added = 0;
+    for (const auto &pair : pairs) {
+        added += hash.set(pair.first, pair.second, encoding_limits) ? 1 : 0;
     }
-    return list.size();
+    account(stripe, before, entry.memory_usage());
+    return added;
 }
 
-std::string Database::rpop(const std::string &key) {
-    std::lock_guard lock(mutex);
-    if (is_expired(key)) {
-        return "NULL";
+std::string Database::hget(std::string_view key, std::string_view field) {
+    Stripe &stripe = stripe_for(key);
+    bool expired;
+    {
+        auto lock = lock_stripe_shared(stripe);
+        const Value *value = find_live(stripe, key, expired);
+        if (value != nullptr) {
+            std::string_view found;
+            if (value->type() != DataType::HASH || !value->hash_val().get(field, found)) {
+                return "NULL";
+            }
+            return std::string(found);
+        }
+    }
+    if (expired) {
+        reap_expired(stripe, key);
     }
+    return "NULL";
+}
 
-    if (!check_type(key, DataType::LIST)) {
-        return "NULL"; // Type mismatch
+void Database::hget(std::string_view key, std::string_view field, ReplyBuilder &reply) {
+    bool found = read_live(key, [&](const Value &value) {
+        std::string_view result;
+        if (value.type() == DataType::HASH && value.hash_val().get(field, result)) {
+            reply.bulk(result);
+        } else {
+            reply.null();
+        }
+    });
+    if (!found) {
+        reply.null();
     }
+}
 
-    auto& list = data[key].list_val;
-    if (list.empty()) {
-        return "NULL"; // List is empty
+std::vector<std::string> Database::hmget(std::string_view key, const std::vector<std::string> &fields) {
+    Stripe &stripe = stripe_for(key);
+    bool expired;
+    {
+        auto lock = lock_stripe_shared(stripe);
+        const Value *value = find_live(stripe, key, expired);
+        if (value != nullptr && value->type() == DataType::HASH) {
+            std::vector<std::string> result;
+            result.reserve(fields.size());
+            std::string_view found;
+            for (const auto &field : fields) {
+                result.emplace_back(value->hash_val().get(field, found) ? found : "NULL");
+            }
+            return result;
+        }
     }
-    std::string value = list.back();
-    list.pop_back();
-    if (list.empty()) {
-        data.erase(key);
+    if (expired) {
+        reap_expired(stripe, key);
     }
-    return value;
+    return std::vector<std::string>(fields.size(), "NULL");
 }
 
-std::vector<std::string> Database::lrange(const std::string &key, int start, int end) {
-    std::lock_guard lock(mutex);
-    if (is_expired(key)) {
-        return {}; // Return empty vector if key is expired
+void Database::hmget(std::string_view key, const std::vector<std::string_view> &fields, ReplyBuilder &reply) {
+    reply.array(fields.size());
+    bool found = read_live(key, [&](const Value &value) {
+        std::string_view result;
+        for (std::string_view field : fields) {
+            if (value.type() == DataType::HASH && value.hash_val().get(field, result)) {
+                reply.bulk(result);
+            } else {
+                reply.null();
+            }
+        }
+    });
+    if (!found) {
+        for (std::size_t i = 0; i < fields.size(); i++) {
+            reply.null();
+        }
     }
-    if (!check_type(key, DataType::LIST)) {
-        return {}; // Type mismatch
+}
+
+bool Database::hdel(std::string_view key, std::string_view field) {
+    Stripe &stripe = stripe_for(key);
+    auto lock = lock_stripe(stripe);
+
+    if (is_expired(stripe, key) || !check_type(stripe, key, DataType::HASH)) {
+        return false;
     }
-    auto& list = data[key].list_val;
-    int orig_start = start;
-    int orig_end = end;
-    if (start < 0) {
-        start = std::max(0, static_cast<int>(list.size()) + start);
+    auto &entry = stripe.data[key];
+    std::size_t before = entry.memory_usage();
+    auto &hash = entry.hash_val();
+    if (!hash.del(field)) {
+        return false;
     }
-    if (end < 0) {
-        end = std::max(0, static_cast<int>(list.size()) + end);
+    account(stripe, before, entry.memory_usage());
+    if (hash.size() == 0) {
+        remove_key(stripe, key);
     }
-    if (start == end && orig_start < 0 && orig_end < 0 &&
-        -orig_start > static_cast<int>(list.size()) &&
-        -orig_end > static_cast<int>(list.size())) {
-        return {};
+    return true;
+}
+
+long long Database::hdel(std::string_view key, const std::vector<std::string> &fields) {
+    Stripe &stripe = stripe_for(key);
+    auto lock = lock_stripe(stripe);
+
+    if (is_expired(stripe, key) || !check_type(stripe, key, DataType::HASH)) {
+        return 0;
     }
-    if (start > end || start >= static_cast<int>(list.size())) {
-        return {}; // Invalid range
+    auto &entry = stripe.data[key];
+    std::size_t before = entry.memory_usage();
+    auto &hash = entry.hash_val();
+    long long removed = 0;
+    for (const auto &field : fields) {
+        removed += hash.del(field) ? 1 : 0;
     }
-    end = std::min(end, static_cast<int>(list.size()) - 1);
-    std::vector<std::string> result(list.begin() + start, list.begin() + end + 1);
-    return result;
+    account(stripe, before, entry.memory_usage());
+    if (hash.size() == 0) {
+        remove_key(stripe, key);
+    }
+    return removed;
+}
+
+std::unordered_map<std::string, std::string> Database::hgetall(std::string_view key) {
+    Stripe &stripe = stripe_for(key);
+    bool expired;
+    {
+        auto lock = lock_stripe_shared(stripe);
+        const Value *value = find_live(stripe, key, expired);
+        if (value != nullptr) {
+            std::unordered_map<std::string, std::string> result;
+            if (value->type() == DataType::HASH) {
+                const auto &hash = value->hash_val();
+                result.reserve(hash.size());
+                hash.for_each([&result](std::string_view field, std::string_view val) {
+                    result.emplace(field, val);
+                });
+            }
+            return result;
+        }
+    }
+    if (expired) {
+        reap_expired(stripe, key);
+    }
+    return {};
 }
 
+void Database::hgetall(std::string_view key, ReplyBuilder &reply) {
+    bool found = read_live(key, [&reply](const Value &value) {
+        if (value.type() != DataType::HASH) {
+            reply.array(0);
+            return;
+        }
+        const auto &hash = value.hash_val();
+        reply.array(hash.size() * 2);
+        hash.for_each([&reply](std::string_view field, std::string_view val) {
+            reply.bulk(field);
+            reply.bulk(val);
+        });
+    });
+    if (!found) {
+        reply.array(0);
+    }
+}
 
-// Key operations
-bool Database::exists(const std::string &key) {
-    std::lock_guard lock(mutex);
+bool Database::hincrby(std::string_view key, std::string_view field, long long increment,
+                       long long &result) {
+    Stripe &stripe = stripe_for(key);
+    auto lock = lock_stripe(stripe);
 
-    if (is_expired(key)) {
+    is_expired(stripe, key);
+    auto it = stripe.data.find(key);
+    long long current = 0;
+    if (it != stripe.data.end()) {
+        if (it->second.type() != DataType::HASH) {
+            return false; // Type mismatch
+        }
+        std::string_view stored;
+        if (it->second.hash_val().get(field, stored)) {
+            auto parsed = std::from_chars(stored.data(), stored.data() + stored.size(), current);
+            if (parsed.ec != std::errc() || parsed.ptr != stored.data() + stored.size()) {
+                return false;
+            }
+        }
+    }
+    if ((increment > 0 && current > LLONG_MAX - increment) ||
+        (increment < 0 && current < LLONG_MIN - increment)) {
         return false;
     }
+    result = current + increment;
 
-    return data.find(key) != data.end();
+    if (it == stripe.data.end()) {
+        it = stripe.data.try_emplace(key, DataType::HASH).first;
+        init_access(it->second);
+        account(stripe, 0, entry_bytes(key, it->second));
+    } else {
+        touch(it->second);
+    }
+    std::size_t before = it->second.memory_usage();
+    it->second.hash_val().set(field, std::to_string(result), encoding_limits);
+    account(stripe, before, it->second.memory_usage());
+    return true;
 }
 
+// Set operations
+long long Database::sadd(std::string_view key, const std::set<std::string> &members) {
+    Stripe &stripe = stripe_for(key);
+    auto lock = lock_stripe(stripe);
 
-bool Database::expire(const std::string &key, int seconds) {
-    std::lock_guard lock(mutex);
+    is_expired(stripe, key);
+    if (!check_or_create_type(stripe, key, DataType::SET)) {
+        return 0; // Type mismatch
+    }
+    auto &entry = stripe.data[key];
+    std::size_t before = entry.memory_usage();
+    auto &set = entry.set_val();
+    long long added = 0;
+    for (const auto &member : members) {
+        added += set.add(member, encoding_limits) ? 1 : 0;
+    }
+    account(stripe, before, entry.memory_usage());
+    if (set.size() == 0) {
+        remove_key(stripe, key); // Nothing was added to a fresh key
+    }
+    return added;
+}
 
-    auto it = data.find(key);
-    if (it == data.end()) {
+long long Database::srem(std::string_view key, const std::set<std::string> &members) {
+    Stripe &stripe = stripe_for(key);
+    auto lock = lock_stripe(stripe);
+
+    if (is_expired(stripe, key) || !check_type(stripe, key, DataType::SET)) {
+        return 0;
+    }
+    auto &entry = stripe.data[key];
+    std::size_t before = entry.memory_usage();
+    auto &set = entry.set_val();
+    long long removed = 0;
+    for (const auto &member : members) {
+        removed += set.remove(member) ? 1 : 0;
+    }
+    account(stripe, before, entry.memory_usage());
+    if (set.size() == 0) {
+        remove_key(stripe, key);
+    }
+    return removed;
+}
+
+bool Database::sismember(std::string_view key, std::string_view member) {
+    Stripe &stripe = stripe_for(key);
+    bool expired;
+    {
+        auto lock = lock_stripe_shared(stripe);
+        const Value *value = find_live(stripe, key, expired);
+        if (value != nullptr) {
+            return value->type() == DataType::SET && value->set_val().contains(member);
+        }
+    }
+    if (expired) {
+        reap_expired(stripe, key);
+    }
+    return false;
+}
+
+std::set<std::string> Database::smembers(std::string_view key) {
+    Stripe &stripe = stripe_for(key);
+    bool expired;
+    {
+        auto lock = lock_stripe_shared(stripe);
+        const Value *value = find_live(stripe, key, expired);
+        if (value != nullptr) {
+            std::set<std::string> result;
+            if (value->type() == DataType::SET) {
+                value->set_val().for_each([&result](std::string_view member) {
+                    result.emplace(member);
+                });
+            }
+            return result;
+        }
+    }
+    if (expired) {
+        reap_expired(stripe, key);
+    }
+    return {};
+}
+
+void Database::smembers(std::string_view key, ReplyBuilder &reply) {
+    bool found = read_live(key, [&reply](const Value &value) {
+        if (value.type() != DataType::SET) {
+            reply.array(0);
+            return;
+        }
+        const auto &set = value.set_val();
+        reply.array(set.size());
+        set.for_each([&reply](std::string_view member) {
+            reply.bulk(member);
+        });
+    });
+    if (!found) {
+        reply.array(0);
+    }
+}
+
+long long Database::scard(std::string_view key) {
+    Stripe &stripe = stripe_for(key);
+    bool expired;
+    {
+        auto lock = lock_stripe_shared(stripe);
+        const Value *value = find_live(stripe, key, expired);
+        if (value != nullptr) {
+            return value->type() == DataType::SET ? static_cast<long long>(value->set_val().size()) : 0;
+        }
+    }
+    if (expired) {
+        reap_expired(stripe, key);
+    }
+    return 0;
+}
+
+// Sorted set operations
+long long Database::zadd(std::string_view key, const std::vector<std::pair<double, std::string>> &entries) {
+    Stripe &stripe = stripe_for(key);
+    auto lock = lock_stripe(stripe);
+
+    is_expired(stripe, key);
+    if (!check_or_create_type(stripe, key, DataType::ZSET)) {
+        return 0; // Type mismatch
+    }
+    auto &value = stripe.data[key];
+    std::size_t before = value.memory_usage();
+    auto &zset = value.zset_val();
+    long long added = 0;
+    for (const auto &entry : entries) {
+        added += zset.add(entry.second, entry.first, encoding_limits) ? 1 : 0;
+    }
+    account(stripe, before, value.memory_usage());
+    return added;
+}
+
+long long Database::zrem(std::string_view key, const std::vector<std::string> &members) {
+    Stripe &stripe = stripe_for(key);
+    auto lock = lock_stripe(stripe);
+
+    if (is_expired(stripe, key) || !check_type(stripe, key, DataType::ZSET)) {
+        return 0;
+    }
+    auto &entry = stripe.data[key];
+    std::size_t before = entry.memory_usage();
+    auto &zset = entry.zset_val();
+    long long removed = 0;
+    for (const auto &member : members) {
+        removed += zset.remove(member) ? 1 : 0;
+    }
+    account(stripe, before, entry.memory_usage());
+    if (zset.size() == 0) {
+        remove_key(stripe, key);
+    }
+    return removed;
+}
+
+bool Database::zscore(std::string_view key, std::string_view member, double &score) {
+    Stripe &stripe = stripe_for(key);
+    bool expired;
+    {
+        auto lock = lock_stripe_shared(stripe);
+        const Value *value = find_live(stripe, key, expired);
+        if (value != nullptr) {
+            return value->type() == DataType::ZSET && value->zset_val().score(member, score);
+        }
+    }
+    if (expired) {
+        reap_expired(stripe, key);
+    }
+    return false;
+}
+
+bool Database::zrank(std::string_view key, std::string_view member, long long &rank) {
+    Stripe &stripe = stripe_for(key);
+    bool expired;
+    {
+        auto lock = lock_stripe_shared(stripe);
+        const Value *value = find_live(stripe, key, expired);
+        if (value != nullptr) {
+            std::size_t position;
+            if (value->type() != DataType::ZSET || !value->zset_val().rank(member, position)) {
+                return false;
+            }
+            rank = static_cast<long long>(position);
+            return true;
+        }
+    }
+    if (expired) {
+        reap_expired(stripe, key);
+    }
+    return false;
+}
+
+long long Database::zcard(std::string_view key) {
+    Stripe &stripe = stripe_for(key);
+    bool expired;
+    {
+        auto lock = lock_stripe_shared(stripe);
+        const Value *value = find_live(stripe, key, expired);
+        if (value != nullptr) {
+            return value->type() == DataType::ZSET ? static_cast<long long>(value->zset_val().size()) : 0;
+        }
+    }
+    if (expired) {
+        reap_expired(stripe, key);
+    }
+    return 0;
+}
+
+namespace {
+
+    // Writes ranks start..stop (already clamped) of `zset` as one reply array
+    void reply_rank_range(const ZSet &zset, std::size_t start, std::size_t stop, bool with_scores,
+                          ReplyBuilder &reply) {
+        std::size_t count = stop - start + 1;
+        reply.array(with_scores ? count * 2 : count);
+        zset.for_rank_range(start, stop, [&reply, with_scores](std::string_view member, double score) {
+            reply.bulk(member);
+            if (with_scores) {
+                reply.bulk(ZSet::format_score(score));
+            }
+        });
+    }
+
+}
+
+void Database::zrange(std::string_view key, long long start, long long stop, bool with_scores,
+                      ReplyBuilder &reply) {
+    Stripe &stripe = stripe_for(key);
+    bool expired;
+    {
+        auto lock = lock_stripe_shared(stripe);
+        const Value *value = find_live(stripe, key, expired);
+        if (value != nullptr && value->type() == DataType::ZSET) {
+            const auto &zset = value->zset_val();
+            auto size = static_cast<long long>(zset.size());
+            if (start < 0) {
+                start = std::max(0LL, size + start);
+            }
+            if (stop < 0) {
+                stop += size;
+            }
+            stop = std::min(stop, size - 1);
+            if (start > stop) {
+                reply.array(0);
+                return;
+            }
+            reply_rank_range(zset, static_cast<std::size_t>(start), static_cast<std::size_t>(stop), with_scores, reply);
+            return;
+        }
+    }
+    if (expired) {
+        reap_expired(stripe, key);
+    }
+    reply.array(0);
+}
+
+void Database::zrangebyscore(std::string_view key, const ScoreRange &range, bool with_scores,
+                             long long offset, long long count, ReplyBuilder &reply) {
+    Stripe &stripe = stripe_for(key);
+    bool expired;
+    {
+        auto lock = lock_stripe_shared(stripe);
+        const Value *value = find_live(stripe, key, expired);
+        if (value != nullptr && value->type() == DataType::ZSET) {
+            const auto &zset = value->zset_val();
+            auto span = zset.rank_span(range);
+            std::size_t first = span.first + static_cast<std::size_t>(std::max(0LL, offset));
+            std::size_t last = span.second;
+            if (count >= 0 && first < last) {
+                last = std::min(last, first + static_cast<std::size_t>(count));
+            }
+            if (offset < 0 || first >= last) {
+                reply.array(0);
+                return;
+            }
+            reply_rank_range(zset, first, last - 1, with_scores, reply);
+            return;
+        }
+    }
+    if (expired) {
+        reap_expired(stripe, key);
+    }
+    reply.array(0);
+}
+
+// Key operations
+bool Database::exists(std::string_view key) {
+    Stripe &stripe = stripe_for(key);
+    bool expired;
+    {
+        auto lock = lock_stripe_shared(stripe);
+        if (find_live(stripe, key, expired) != nullptr) {
+            return true;
+        }
+    }
+    if (expired) {
+        reap_expired(stripe, key);
+    }
+    return false;
+}
+
+long long Database::exists(const std::vector<std::string> &keys) {
+    auto touched = stripes_for(keys);
+    std::vector<ReadLock> locks;
+    locks.reserve(touched.size());
+    for (Stripe *stripe : touched) {
+        locks.push_back(lock_stripe_shared(*stripe));
+    }
+
+    long long found = 0;
+    bool expired;
+    for (const auto &key : keys) {
+        // Expired keys are simply not counted; a later write or read reaps them
+        if (find_live(stripe_for(key), key, expired) != nullptr) {
+            found++;
+        }
+    }
+    return found;
+}
+
+
+void Database::set_deadline(Stripe &stripe, std::string_view key,
+                            std::chrono::steady_clock::time_point deadline) {
+    bool added = stripe.expires.insert_or_assign(key, deadline).second;
+    account(stripe, 0, added ? string_heap_bytes(key.size()) : 0);
+    std::uint64_t tick = wheel_tick(deadline);
+    auto scheduled = stripe.scheduled.find(key);
+    if (scheduled != stripe.scheduled.end()) {
+        if (scheduled->second <= tick) {
+            return; // The key's entry fires first and moves on to `tick`
+        }
+        scheduled->second = tick; // Earlier: the old entry goes stale
+    } else {
+        stripe.scheduled.emplace(key, tick);
+        account(stripe, 0, string_heap_bytes(key.size()));
+    }
+    if (!stripe.wheel) {
+        stripe.wheel = std::make_unique<TimerWheel>(wheel_tick(std::chrono::steady_clock::now()));
+    }
+    stripe.wheel->insert(key, tick);
+    account(stripe, 0, 0);
+}
+
+bool Database::expire_at(std::string_view key, std::chrono::steady_clock::time_point deadline) {
+    Stripe &stripe = stripe_for(key);
+    auto lock = lock_stripe(stripe);
+    auto &data = stripe.data;
+
+    if (is_expired(stripe, key)) {
+        return false;
+    }
+    if (data.find(key) == data.end()) {
         return false;
     }
 
-    it->second.has_expiry = true;
-    it->second.expiry = std::chrono::steady_clock::now() + std::chrono::seconds(seconds);
+    if (deadline <= std::chrono::steady_clock::now()) {
+        return remove_key(stripe, key); // Already due, as Redis does
+    }
+    set_deadline(stripe, key, deadline);
     return true;
 }
 
-long long Database::ttl(const std::string &key) {
-    std::lock_guard lock(mutex);
+namespace {
 
-    auto it = data.find(key);
-    if (it == data.end()) {
-        return -2; // Key does not exist
+    // Milliseconds left before `now + milliseconds` overflows the steady clock
+    long long clock_headroom(std::chrono::steady_clock::time_point now) {
+        return std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::time_point::max() - now).count();
     }
-    if (!it->second.has_expiry) {
-        return -1; // Key exists but has no expiry
+
+    long long unix_now_ms() {
+        return std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
     }
 
+}
+
+bool Database::expire_in(std::string_view key, long long milliseconds) {
     auto now = std::chrono::steady_clock::now();
-    if (now > it->second.expiry) {
-        data.erase(it);
-        return -2; // Key has expired
+    if (milliseconds > clock_headroom(now)) {
+        return false;
+    }
+    return expire_at(key, milliseconds <= 0 ? now : now + std::chrono::milliseconds(milliseconds));
+}
+
+bool Database::expire(std::string_view key, int seconds) {
+    return expire_in(key, seconds * 1000LL);
+}
+
+bool Database::pexpire(std::string_view key, long long milliseconds) {
+    return expire_in(key, milliseconds);
+}
+
+bool Database::pexpireat(std::string_view key, long long unix_milliseconds) {
+    // Deadlines are kept on the steady clock; translate through the wall clock now
+    long long unix_now = unix_now_ms();
+    return expire_in(key, unix_milliseconds <= unix_now ? 0 : unix_milliseconds - unix_now);
+}
+
+bool Database::ttl_fits(long long milliseconds) {
+    return milliseconds <= clock_headroom(std::chrono::steady_clock::now());
+}
+
+bool Database::unix_deadline_fits(long long unix_milliseconds) {
+    long long unix_now = unix_now_ms();
+    return unix_milliseconds <= unix_now || ttl_fits(unix_milliseconds - unix_now);
+}
+
+long long Database::remaining_ttl(std::string_view key) {
+    Stripe &stripe = stripe_for(key);
+    bool expired;
+    {
+        auto lock = lock_stripe_shared(stripe);
+        if (find_live(stripe, key, expired) != nullptr) {
+            auto deadline = stripe.expires.find(key);
+            if (deadline == stripe.expires.end()) {
+                return -1; // Key exists but has no expiry
+            }
+            auto now = std::chrono::steady_clock::now();
+            return std::chrono::duration_cast<std::chrono::milliseconds>(deadline->second - now).count();
+        }
+    }
+    if (expired) {
+        reap_expired(stripe, key); // Key has expired
+    }
+    return -2; // Key does not exist
+}
+
+long long Database::ttl(std::string_view key) {
+    long long remaining = remaining_ttl(key);
+    // Rounded to the nearest second, as Redis does
+    return remaining < 0 ? remaining : (remaining + 500) / 1000;
+}
+
+long long Database::pttl(std::string_view key) {
+    return remaining_ttl(key);
+}
+
+std::string Database::object_encoding(std::string_view key) {
+    Stripe &stripe = stripe_for(key);
+    bool expired;
+    {
+        auto lock = lock_stripe_shared(stripe);
+        const Value *value = find_live(stripe, key, expired);
+        if (value != nullptr) {
+            switch (value->type()) {
+                case DataType::STRING:
+                    // Short strings live inside the std::string object itself
+                    return value->string_on_heap() ? "raw" : "embstr";
+                case DataType::LIST:
+                    return "quicklist";
+                case DataType::HASH:
+                    return value->hash_val().encoding_name();
+                case DataType::SET:
+                    return value->set_val().encoding_name();
+                case DataType::ZSET:
+                    return value->zset_val().encoding_name();
+            }
+        }
+    }
+    if (expired) {
+        reap_expired(stripe, key);
+    }
+    return "";
+}
+
+std::size_t Database::dbsize() {
+    std::size_t keys = 0;
+    for (std::size_t i = 0; i < stripe_count; i++) {
+        auto lock = lock_stripe_shared(stripes[i]);
+        keys += stripes[i].data.size();
+    }
+    return keys;
+}
+
+std::size_t Database::used_memory() const {
+    std::size_t bytes = 0;
+    for (std::size_t i = 0; i < stripe_count; i++) {
+        bytes += stripes[i].used_memory.load(std::memory_order_relaxed);
     }
+    return bytes;
+}
+
+void Database::set_maxmemory(std::size_t bytes, EvictionPolicy policy, std::size_t samples) {
+    maxmemory = bytes;
+    eviction_policy = policy;
+    eviction_samples = std::max<std::size_t>(samples, 1);
+}
+
+bool Database::parse_eviction_policy(std::string_view name, EvictionPolicy &policy) {
+    for (const auto &entry : eviction_policy_names) {
+        if (entry.first == name) {
+            policy = entry.second;
+            return true;
+        }
+    }
+    return false;
+}
 
-    auto remaining = std::chrono::duration_cast<std::chrono::seconds>(it->second.expiry - now).count();
-    return remaining;
+const char *Database::eviction_policy_name(EvictionPolicy policy) {
+    for (const auto &entry : eviction_policy_names) {
+        if (entry.second == policy) {
+            return entry.first;
+        }
+    }
+    return "noeviction";
+}
+
+void Database::update_clock() {
+    clock_ms.store(static_cast<std::uint32_t>(wheel_tick(std::chrono::steady_clock::now())),
+                   std::memory_order_relaxed);
+}
+
+// Under LRU the access word is the clock at the last access. Under LFU it
+// packs the minute of the last decay (high 16 bits) above an 8-bit
+// logarithmic counter, as Redis does.
+void Database::init_access(const Value &value) const {
+    std::uint32_t now = clock_ms.load(std::memory_order_relaxed);
+    if (eviction_policy == EvictionPolicy::AllKeysLfu) {
+        value.set_access(((now / 60000) & 0xFFFF) << 8 | lfu_init);
+    } else {
+        value.set_access(now);
+    }
+}
+
+void Database::touch(const Value &value) const {
+    std::uint32_t now = clock_ms.load(std::memory_order_relaxed);
+    if (eviction_policy != EvictionPolicy::AllKeysLfu) {
+        value.set_access(now);
+        return;
+    }
+    std::uint32_t counter = lfu_counter(value.access());
+    if (counter < 255) {
+        std::uint32_t base = counter > lfu_init ? counter - lfu_init : 0;
+        std::uniform_int_distribution<std::uint32_t> roll(0, base * lfu_log_factor);
+        if (roll(thread_rng()) == 0) {
+            counter++;
+        }
+    }
+    value.set_access(((now / 60000) & 0xFFFF) << 8 | counter);
+}
+
+std::uint32_t Database::lfu_counter(std::uint32_t access) const {
+    std::uint32_t minutes = (clock_ms.load(std::memory_order_relaxed) / 60000) & 0xFFFF;
+    std::uint32_t idle = (minutes - (access >> 8)) & 0xFFFF;
+    std::uint32_t counter = access & 0xFF;
+    return idle >= counter ? 0 : counter - idle;
+}
+
+void Database::sample_eviction_pool() {
+    bool volatile_only = eviction_policy == EvictionPolicy::VolatileLru ||
+                         eviction_policy == EvictionPolicy::VolatileTtl;
+    std::uint32_t now = clock_ms.load(std::memory_order_relaxed);
+    auto consider = [this](std::uint64_t score, std::string_view key) {
+        auto &pool = eviction_pool;
+        if (pool.size() == eviction_pool_size && score <= pool.front().score) {
+            return; // Worse than every candidate already kept
+        }
+        auto existing = std::find_if(pool.begin(), pool.end(), [key](const EvictionCandidate &candidate) {
+            return candidate.key == key;
+        });
+        if (existing != pool.end()) {
+            pool.erase(existing);
+        }
+        auto pos = std::upper_bound(pool.begin(), pool.end(), score,
+                                    [](std::uint64_t wanted, const EvictionCandidate &candidate) {
+                                        return wanted < candidate.score;
+                                    });
+        pool.insert(pos, EvictionCandidate{score, std::string(key)});
+        if (pool.size() > eviction_pool_size) {
+            pool.erase(pool.begin());
+        }
+    };
+
+    // Keys are spread evenly over the stripes, so a random slot range of a
+    // random stripe is a fair sample; move on only while stripes are empty
+    std::size_t sampled = 0;
+    std::size_t first = eviction_rng() % stripe_count;
+    for (std::size_t visited = 0; visited < stripe_count && sampled < eviction_samples; visited++) {
+        Stripe &stripe = stripes[(first + visited) % stripe_count];
+        auto lock = lock_stripe_shared(stripe);
+        std::size_t wanted = eviction_samples - sampled;
+        if (volatile_only) {
+            stripe.expires.scan(eviction_rng(), wanted, [&](auto it) {
+                sampled++;
+                if (eviction_policy == EvictionPolicy::VolatileTtl) {
+                    // The nearest deadline scores highest
+                    consider(std::numeric_limits<std::uint64_t>::max() - wheel_tick(it->second), it->first);
+                    return;
+                }
+                auto entry = stripe.data.find(it->first);
+                if (entry != stripe.data.end()) {
+                    consider(static_cast<std::uint32_t>(now - entry->second.access()), it->first);
+                }
+            });
+        } else {
+            stripe.data.scan(eviction_rng(), wanted, [&](auto it) {
+                sampled++;
+                std::uint32_t access = it->second.access();
+                if (eviction_policy == EvictionPolicy::AllKeysLfu) {
+                    consider(255 - lfu_counter(access), it->first);
+                } else {
+                    consider(static_cast<std::uint32_t>(now - access), it->first);
+                }
+            });
+        }
+    }
+}
+
+bool Database::evict_one() {
+    std::unique_lock<std::mutex> pool_lock(eviction_mutex, std::defer_lock);
+    if (synchronized) {
+        pool_lock.lock();
+    }
+    sample_eviction_pool();
+    // Candidates may have been deleted since they were sampled; skip those
+    while (!eviction_pool.empty()) {
+        std::string key = std::move(eviction_pool.back().key);
+        eviction_pool.pop_back();
+        Stripe &stripe = stripe_for(key);
+        auto lock = lock_stripe(stripe);
+        bool volatile_only = eviction_policy == EvictionPolicy::VolatileLru ||
+                             eviction_policy == EvictionPolicy::VolatileTtl;
+        if (volatile_only && stripe.expires.find(key) == stripe.expires.end()) {
+            continue;
+        }
+        if (remove_key(stripe, key)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool Database::free_memory_if_needed() {
+    if (maxmemory == 0) {
+        return true;
+    }
+    while (used_memory() > maxmemory) {
+        if (eviction_policy == EvictionPolicy::NoEviction || !evict_one()) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool Database::cleanup_expired_keys(std::chrono::microseconds budget) {
+    auto deadline = std::chrono::steady_clock::now() + budget;
+    for (std::size_t visited = 0; visited < stripe_count; visited++) {
+        std::size_t index = (expire_stripe_cursor + visited) % stripe_count;
+        Stripe &stripe = stripes[index];
+        auto lock = lock_stripe(stripe);
+        if (!stripe.wheel) {
+            continue;
+        }
+
+        auto now = std::chrono::steady_clock::now();
+        std::size_t fired = 0;
+        auto fire = [this, &stripe, now](std::string_view key, std::uint64_t tick) {
+            auto scheduled = stripe.scheduled.find(key);
+            if (scheduled == stripe.scheduled.end() || scheduled->second != tick) {
+                return TimerWheel::none; // Stale: an earlier deadline replaced it
+            }
+            auto it = stripe.expires.find(key);
+            std::uint64_t due = it == stripe.expires.end() ? TimerWheel::none : wheel_tick(it->second);
+            if (due != TimerWheel::none && due > tick) {
+                scheduled->second = due; // The TTL was extended: follow it
+                return due;
+            }
+            if (due != TimerWheel::none && now <= it->second) {
+                return tick; // Due within this millisecond, retry on the next
+            }
+            // The deadline passed, or the key or its TTL is gone
+            stripe.scheduled.erase(key);
+            account(stripe, string_heap_bytes(key.size()), 0);
+            if (due != TimerWheel::none) {
+                remove_key(stripe, key);
+            }
+            return TimerWheel::none;
+        };
+        auto out_of_time = [&fired, deadline]() {
+            return ++fired % expire_batch == 0 && std::chrono::steady_clock::now() >= deadline;
+        };
+        bool finished = stripe.wheel->advance(wheel_tick(now), fire, out_of_time);
+        account(stripe, 0, 0);
+        if (!finished) {
+            // Pick up with this stripe next time
+            expire_stripe_cursor = index;
+            return true;
+        }
+    }
+    expire_stripe_cursor = 0;
+    return false;
+}
+
+bool Database::incremental_rehash(std::chrono::microseconds budget) {
+    auto deadline = std::chrono::steady_clock::now() + budget;
+    bool pending = false;
+    for (std::size_t i = 0; i < stripe_count; i++) {
+        Stripe &stripe = stripes[i];
+        auto lock = lock_stripe(stripe);
+        // Small steps keep each lock hold short; check the clock between them.
+        // Both maps are stepped every round, hence the non-short-circuit '|'.
+        while (stripe.data.rehash_step(64) | stripe.expires.rehash_step(64)) {
+            if (std::chrono::steady_clock::now() >= deadline) {
+                account(stripe, 0, 0);
+                return true;
+            }
+        }
+        account(stripe, 0, 0); // a finished migration frees the old table
+        pending = pending || stripe.data.rehashing() || stripe.expires.rehashing();
+    }
+    return pending;
 }
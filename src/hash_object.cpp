@@ -0,0 +1,102 @@
+//
+// Hash value with a compact listpack encoding for small hashes.
+//
+
+#include "hash_object.h"
+#include "memory_usage.h"
+
+std::size_t HashObject::size() const {
+    if (auto *pack = std::get_if<ListPack>(&data_)) {
+        return pack->size() / 2;
+    }
+    return std::get<Table>(data_).size();
+}
+
+std::size_t HashObject::memory_usage() const {
+    if (auto *pack = std::get_if<ListPack>(&data_)) {
+        return pack->bytes();
+    }
+    return std::get<Table>(data_).allocated_bytes() + payload_;
+}
+
+std::size_t HashObject::free_effort() const {
+    return is_listpack() ? 1 : size();
+}
+
+bool HashObject::set(std::string_view field, std::string_view value, const EncodingLimits &limits) {
+    if (auto *pack = std::get_if<ListPack>(&data_)) {
+        std::size_t offset = pack->find(field, 2);
+        bool fits = field.size() <= limits.hash_max_listpack_value &&
+                    value.size() <= limits.hash_max_listpack_value;
+        if (offset != pack->end() && fits) {
+            pack->replace(pack->next(offset), value);
+            return false;
+        }
+        if (offset == pack->end() && fits && size() + 1 <= limits.hash_max_listpack_entries) {
+            pack->push_back(field);
+            pack->push_back(value);
+            return true;
+        }
+        convert_to_table();
+    }
+
+    auto result = std::get<Table>(data_).try_emplace(field, value);
+    if (!result.second) {
+        payload_ -= string_heap_bytes(result.first->second.size());
+        result.first->second.assign(value);
+    } else {
+        payload_ += string_heap_bytes(field.size());
+    }
+    payload_ += string_heap_bytes(value.size());
+    return result.second;
+}
+
+bool HashObject::get(std::string_view field, std::string_view &value) const {
+    if (auto *pack = std::get_if<ListPack>(&data_)) {
+        std::size_t offset = pack->find(field, 2);
+        if (offset == pack->end()) {
+            return false;
+        }
+        value = pack->get(pack->next(offset));
+        return true;
+    }
+    const auto &table = std::get<Table>(data_);
+    auto it = table.find(field);
+    if (it == table.end()) {
+        return false;
+    }
+    value = it->second;
+    return true;
+}
+
+bool HashObject::del(std::string_view field) {
+    if (auto *pack = std::get_if<ListPack>(&data_)) {
+        std::size_t offset = pack->find(field, 2);
+        if (offset == pack->end()) {
+            return false;
+        }
+        pack->erase(offset); // the field
+        pack->erase(offset); // its value, now at the same offset
+        return true;
+    }
+    auto &table = std::get<Table>(data_);
+    auto it = table.find(field);
+    if (it == table.end()) {
+        return false;
+    }
+    payload_ -= string_heap_bytes(field.size()) + string_heap_bytes(it->second.size());
+    table.erase(it);
+    return true;
+}
+
+void HashObject::convert_to_table() {
+    Table table;
+    table.reserve(size() + 1);
+    std::size_t payload = 0;
+    for_each([&table, &payload](std::string_view field, std::string_view value) {
+        table.emplace(field, value);
+        payload += string_heap_bytes(field.size()) + string_heap_bytes(value.size());
+    });
+    data_ = std::move(table);
+    payload_ = payload;
+}
@@ -0,0 +1,48 @@
+//
+// Cursor-based receive buffer for a client connection.
+//
+
+#include "input_buffer.h"
+#include <algorithm>
+#include <cstring>
+
+InputBuffer::InputBuffer(std::size_t initial_capacity)
+    : storage_(new char[initial_capacity]), capacity_(initial_capacity), initial_capacity_(initial_capacity) {}
+
+char *InputBuffer::prepare(std::size_t min) {
+    if (writable() >= min) {
+        return storage_.get() + end_;
+    }
+    std::size_t used = size();
+    if (capacity_ - used >= min && start_ > 0) {
+        std::memmove(storage_.get(), storage_.get() + start_, used);
+    } else {
+        std::size_t capacity = std::max(capacity_ * 2, used + min);
+        std::unique_ptr<char[]> storage(new char[capacity]);
+        std::memcpy(storage.get(), storage_.get() + start_, used);
+        storage_ = std::move(storage);
+        capacity_ = capacity;
+    }
+    start_ = 0;
+    end_ = used;
+    return storage_.get() + end_;
+}
+
+void InputBuffer::consume(std::size_t count) {
+    start_ += count;
+    if (start_ == end_) {
+        // Nothing left to move: start over at the front, and give back a
+        // block that grew for one large request
+        start_ = end_ = 0;
+        if (capacity_ > 4 * initial_capacity_) {
+            storage_.reset(new char[initial_capacity_]);
+            capacity_ = initial_capacity_;
+        }
+    }
+}
+
+void InputBuffer::erase(std::size_t offset, std::size_t count) {
+    char *from = storage_.get() + start_ + offset;
+    std::memmove(from, from + count, size() - offset - count);
+    end_ -= count;
+}
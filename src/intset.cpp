@@ -0,0 +1,238 @@
+//
+// Set encoding for integer members: a sorted, packed array of integers.
+//
+
+#include "intset.h"
+#include <charconv>
+#include <cstring>
+#include <limits>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define INTSET_AVX2 1
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define INTSET_SSE2 1
+#if defined(__SSE4_2__)
+#include <nmmintrin.h>
+#endif
+#endif
+
+namespace {
+
+    // Below this many elements a linear SIMD count beats more binary search steps
+    constexpr std::size_t scan_window = 32;
+
+    template <typename T>
+    T load(const char *data, std::size_t index) {
+        T value;
+        std::memcpy(&value, data + index * sizeof(T), sizeof(T));
+        return value;
+    }
+
+    inline unsigned popcount(std::uint32_t mask) {
+#if defined(__GNUC__) || defined(__clang__)
+        return static_cast<unsigned>(__builtin_popcount(mask));
+#else
+        unsigned count = 0;
+        for (; mask != 0; mask &= mask - 1) {
+            ++count;
+        }
+        return count;
+#endif
+    }
+
+    // Number of elements in data[0, n) smaller than `value`. The input is
+    // sorted, so this is also the lower bound of `value` within the window.
+    template <typename T>
+    std::size_t count_less(const char *data, std::size_t n, T value) {
+        std::size_t i = 0;
+        std::size_t count = 0;
+#if defined(INTSET_AVX2)
+        constexpr std::size_t lanes = 32 / sizeof(T);
+        __m256i target;
+        if constexpr (sizeof(T) == 2) {
+            target = _mm256_set1_epi16(value);
+        } else if constexpr (sizeof(T) == 4) {
+            target = _mm256_set1_epi32(value);
+        } else {
+            target = _mm256_set1_epi64x(value);
+        }
+        for (; i + lanes <= n; i += lanes) {
+            __m256i elements = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(data + i * sizeof(T)));
+            __m256i less;
+            if constexpr (sizeof(T) == 2) {
+                less = _mm256_cmpgt_epi16(target, elements);
+            } else if constexpr (sizeof(T) == 4) {
+                less = _mm256_cmpgt_epi32(target, elements);
+            } else {
+                less = _mm256_cmpgt_epi64(target, elements);
+            }
+            // One mask bit per byte, so each matching lane sets sizeof(T) bits
+            count += popcount(static_cast<std::uint32_t>(_mm256_movemask_epi8(less))) / sizeof(T);
+        }
+#elif defined(INTSET_SSE2)
+        constexpr std::size_t lanes = 16 / sizeof(T);
+#if !defined(__SSE4_2__)
+        // 64-bit compares need SSE4.2; use the scalar loop below
+        if constexpr (sizeof(T) != 8)
+#endif
+        {
+            __m128i target;
+            if constexpr (sizeof(T) == 2) {
+                target = _mm_set1_epi16(value);
+            } else if constexpr (sizeof(T) == 4) {
+                target = _mm_set1_epi32(value);
+            } else {
+                target = _mm_set1_epi64x(value);
+            }
+            for (; i + lanes <= n; i += lanes) {
+                __m128i elements = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + i * sizeof(T)));
+                __m128i less;
+                if constexpr (sizeof(T) == 2) {
+                    less = _mm_cmpgt_epi16(target, elements);
+                } else if constexpr (sizeof(T) == 4) {
+                    less = _mm_cmpgt_epi32(target, elements);
+                } else {
+#if defined(__SSE4_2__)
+                    less = _mm_cmpgt_epi64(target, elements);
+#endif
+                }
+                count += popcount(static_cast<std::uint32_t>(_mm_movemask_epi8(less))) / sizeof(T);
+            }
+        }
+#endif
+        for (; i < n; ++i) {
+            count += load<T>(data, i) < value ? 1 : 0;
+        }
+        return count;
+    }
+
+    template <typename T>
+    std::size_t lower_bound_in(const char *data, std::size_t n, T value) {
+        std::size_t low = 0;
+        std::size_t high = n;
+        while (high - low > scan_window) {
+            std::size_t mid = low + (high - low) / 2;
+            if (load<T>(data, mid) < value) {
+                low = mid + 1;
+            } else {
+                high = mid;
+            }
+        }
+        return low + count_less<T>(data + low * sizeof(T), high - low, value);
+    }
+
+}
+
+bool IntSet::parse(std::string_view text, std::int64_t &value) {
+    if (text.empty() || text.size() > 20) {
+        return false;
+    }
+    std::size_t digits = text[0] == '-' ? 1 : 0;
+    // Reject "-", "-0", "007" and the like: they would not print back the same
+    if (digits == text.size() || (text[digits] == '0' && (digits == 1 || text.size() > 1))) {
+        return false;
+    }
+    auto result = std::from_chars(text.data(), text.data() + text.size(), value);
+    return result.ec == std::errc() && result.ptr == text.data() + text.size();
+}
+
+std::size_t IntSet::width_for(std::int64_t value) {
+    if (value >= std::numeric_limits<std::int16_t>::min() && value <= std::numeric_limits<std::int16_t>::max()) {
+        return sizeof(std::int16_t);
+    }
+    if (value >= std::numeric_limits<std::int32_t>::min() && value <= std::numeric_limits<std::int32_t>::max()) {
+        return sizeof(std::int32_t);
+    }
+    return sizeof(std::int64_t);
+}
+
+std::int64_t IntSet::at(std::size_t index) const {
+    switch (width_) {
+        case sizeof(std::int16_t):
+            return load<std::int16_t>(buf_.data(), index);
+        case sizeof(std::int32_t):
+            return load<std::int32_t>(buf_.data(), index);
+        default:
+            return load<std::int64_t>(buf_.data(), index);
+    }
+}
+
+void IntSet::store(std::size_t index, std::int64_t value) {
+    char *slot = &buf_[index * width_];
+    if (width_ == sizeof(std::int16_t)) {
+        auto narrow = static_cast<std::int16_t>(value);
+        std::memcpy(slot, &narrow, sizeof(narrow));
+    } else if (width_ == sizeof(std::int32_t)) {
+        auto narrow = static_cast<std::int32_t>(value);
+        std::memcpy(slot, &narrow, sizeof(narrow));
+    } else {
+        std::memcpy(slot, &value, sizeof(value));
+    }
+}
+
+std::size_t IntSet::lower_bound(std::int64_t value) const {
+    switch (width_) {
+        case sizeof(std::int16_t):
+            return lower_bound_in<std::int16_t>(buf_.data(), size(), static_cast<std::int16_t>(value));
+        case sizeof(std::int32_t):
+            return lower_bound_in<std::int32_t>(buf_.data(), size(), static_cast<std::int32_t>(value));
+        default:
+            return lower_bound_in<std::int64_t>(buf_.data(), size(), value);
+    }
+}
+
+bool IntSet::contains(std::int64_t value) const {
+    if (width_for(value) > width_) {
+        return false; // Out of range for every stored element
+    }
+    std::size_t index = lower_bound(value);
+    return index < size() && at(index) == value;
+}
+
+bool IntSet::insert(std::int64_t value) {
+    if (width_for(value) > width_) {
+        // A value too wide for the current encoding is smaller or larger than
+        // every element, so after the upgrade it goes at one end
+        upgrade(width_for(value));
+        if (value < 0) {
+            buf_.insert(0, width_, '\0');
+            store(0, value);
+        } else {
+            buf_.append(width_, '\0');
+            store(size() - 1, value);
+        }
+        return true;
+    }
+
+    std::size_t index = lower_bound(value);
+    if (index < size() && at(index) == value) {
+        return false;
+    }
+    buf_.insert(index * width_, width_, '\0');
+    store(index, value);
+    return true;
+}
+
+bool IntSet::erase(std::int64_t value) {
+    if (width_for(value) > width_) {
+        return false;
+    }
+    std::size_t index = lower_bound(value);
+    if (index >= size() || at(index) != value) {
+        return false;
+    }
+    buf_.erase(index * width_, width_);
+    return true;
+}
+
+void IntSet::upgrade(std::size_t width) {
+    IntSet wider;
+    wider.width_ = width;
+    wider.buf_.resize(size() * width);
+    for (std::size_t i = 0; i < size(); i++) {
+        wider.store(i, at(i));
+    }
+    *this = std::move(wider);
+}
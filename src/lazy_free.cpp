@@ -0,0 +1,61 @@
+//
+// Background destruction of large values, in the spirit of Redis' lazyfree.
+//
+
+#include "lazy_free.h"
+
+LazyFree &LazyFree::shared() {
+    static LazyFree instance;
+    return instance;
+}
+
+LazyFree::LazyFree() : thread_([this]() { run(); }) {}
+
+LazyFree::~LazyFree() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    wake_.notify_one();
+    thread_.join();
+}
+
+void LazyFree::enqueue(std::unique_ptr<Garbage> garbage) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        queue_.push_back(std::move(garbage));
+        pending_++;
+    }
+    wake_.notify_one();
+}
+
+std::size_t LazyFree::pending() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return pending_;
+}
+
+void LazyFree::drain() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    idle_.wait(lock, [this]() { return pending_ == 0; });
+}
+
+void LazyFree::run() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+        wake_.wait(lock, [this]() { return stopping_ || !queue_.empty(); });
+        if (queue_.empty()) {
+            return; // stopping with nothing left
+        }
+        // Take the whole batch so producers never wait behind destructors
+        std::deque<std::unique_ptr<Garbage>> batch;
+        batch.swap(queue_);
+        lock.unlock();
+        std::size_t freed = batch.size();
+        batch.clear();
+        lock.lock();
+        pending_ -= freed;
+        if (pending_ == 0) {
+            idle_.notify_all();
+        }
+    }
+}
@@ -0,0 +1,137 @@
+//
+// Contiguous, length-prefixed encoding for small sequences of strings.
+//
+
+#include "listpack.h"
+
+namespace {
+
+    std::size_t varint_size(std::size_t value) {
+        std::size_t size = 1;
+        while (value >= 0x80) {
+            value >>= 7;
+            ++size;
+        }
+        return size;
+    }
+
+    // Forward varint: low 7 bits first, high bit set while more bytes follow
+    char *write_varint(char *out, std::size_t value) {
+        while (value >= 0x80) {
+            *out++ = static_cast<char>((value & 0x7F) | 0x80);
+            value >>= 7;
+        }
+        *out++ = static_cast<char>(value);
+        return out;
+    }
+
+    std::size_t read_varint(const char *in, std::size_t &length) {
+        std::size_t value = 0;
+        unsigned shift = 0;
+        std::size_t i = 0;
+        while (true) {
+            auto byte = static_cast<unsigned char>(in[i++]);
+            value |= static_cast<std::size_t>(byte & 0x7F) << shift;
+            if ((byte & 0x80) == 0) {
+                break;
+            }
+            shift += 7;
+        }
+        length = value;
+        return i;
+    }
+
+    // Backward varint: the last byte carries the low 7 bits and the high bit
+    // is set while more bytes precede it
+    char *write_backlen(char *out, std::size_t value) {
+        std::size_t size = varint_size(value);
+        for (std::size_t i = 0; i < size; ++i) {
+            auto chunk = static_cast<unsigned char>(value & 0x7F);
+            value >>= 7;
+            out[size - 1 - i] = static_cast<char>(i + 1 < size ? chunk | 0x80 : chunk);
+        }
+        return out + size;
+    }
+
+    // Reads the backlen ending just before `end`; returns the entry body size
+    std::size_t read_backlen(const char *end, std::size_t &backlen_size) {
+        std::size_t value = 0;
+        unsigned shift = 0;
+        std::size_t i = 0;
+        while (true) {
+            auto byte = static_cast<unsigned char>(end[-1 - static_cast<std::ptrdiff_t>(i++)]);
+            value |= static_cast<std::size_t>(byte & 0x7F) << shift;
+            if ((byte & 0x80) == 0) {
+                break;
+            }
+            shift += 7;
+        }
+        backlen_size = i;
+        return value;
+    }
+
+}
+
+std::size_t ListPack::encoded_size(std::size_t length) {
+    std::size_t body = varint_size(length) + length;
+    return body + varint_size(body);
+}
+
+std::size_t ListPack::next(std::size_t offset) const {
+    std::size_t length;
+    std::size_t header = read_varint(buf_.data() + offset, length);
+    std::size_t body = header + length;
+    return offset + body + varint_size(body);
+}
+
+std::size_t ListPack::prev(std::size_t offset) const {
+    std::size_t backlen_size;
+    std::size_t body = read_backlen(buf_.data() + offset, backlen_size);
+    return offset - backlen_size - body;
+}
+
+std::string_view ListPack::get(std::size_t offset) const {
+    std::size_t length;
+    std::size_t header = read_varint(buf_.data() + offset, length);
+    return std::string_view(buf_.data() + offset + header, length);
+}
+
+void ListPack::insert(std::size_t offset, std::string_view value) {
+    std::size_t body = varint_size(value.size()) + value.size();
+    std::size_t size = body + varint_size(body);
+
+    // Open a gap at `offset` and encode straight into it
+    buf_.insert(offset, size, '\0');
+    char *out = &buf_[offset];
+    out = write_varint(out, value.size());
+    value.copy(out, value.size());
+    write_backlen(out + value.size(), body);
+    ++count_;
+}
+
+void ListPack::erase(std::size_t offset) {
+    buf_.erase(offset, next(offset) - offset);
+    --count_;
+}
+
+void ListPack::replace(std::size_t offset, std::string_view value) {
+    if (get(offset).size() == value.size()) {
+        // Same length, same encoding: overwrite in place
+        std::size_t length;
+        std::size_t header = read_varint(buf_.data() + offset, length);
+        value.copy(&buf_[offset + header], value.size());
+        return;
+    }
+    erase(offset);
+    insert(offset, value);
+}
+
+std::size_t ListPack::find(std::string_view value, std::size_t stride) const {
+    std::size_t index = 0;
+    for (std::size_t offset = first(); offset != end(); offset = next(offset), ++index) {
+        if (index % stride == 0 && get(offset) == value) {
+            return offset;
+        }
+    }
+    return end();
+}
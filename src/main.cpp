@@ -3,30 +3,134 @@
 #include "database.h"
 #include <boost/asio.hpp>
 #include "server.h"
+#include "shard.h"
+#include "cron.h"
 #include <vector>
 #include <thread>
+#include <memory>
+#include <string>
+#include <cstdlib>
+#include <algorithm>
+#include <cctype>
 
-// Main function to start the server
-int main() {
-    try {
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace {
+
+    struct Options {
+        short port = 6379;
+        unsigned int threads = 0;     // 0 = one per hardware thread
+        bool thread_per_core = false; // one io_context per core instead of a shared pool
+        bool shared_nothing = false;  // per-core loops that each own a keyspace partition
+        EncodingLimits encoding_limits;
+        std::size_t maxmemory = 0;    // bytes, 0 = unlimited
+        EvictionPolicy maxmemory_policy = EvictionPolicy::NoEviction;
+        std::size_t maxmemory_samples = 5;
+    };
+
+    // Parses a byte count with an optional kb/mb/gb suffix (powers of 1024)
+    bool parseMemory(const std::string &text, std::size_t &bytes) {
+        char *end = nullptr;
+        unsigned long long value = std::strtoull(text.c_str(), &end, 10);
+        if (end == text.c_str()) {
+            return false;
+        }
+        std::string unit(end);
+        std::transform(unit.begin(), unit.end(), unit.begin(), [](unsigned char c) { return std::tolower(c); });
+        if (unit == "kb" || unit == "k") {
+            value <<= 10;
+        } else if (unit == "mb" || unit == "m") {
+            value <<= 20;
+        } else if (unit == "gb" || unit == "g") {
+            value <<= 30;
+        } else if (!unit.empty() && unit != "b") {
+            return false;
+        }
+        bytes = static_cast<std::size_t>(value);
+        return true;
+    }
+
+    void printUsage(const char *program) {
+        std::cerr << "Usage: " << program << " [--port <port>] [--threads <n>] [--thread-per-core | --shared-nothing]"
+                  << " [--hash-max-listpack-entries <n>] [--hash-max-listpack-value <bytes>]"
+                  << " [--set-max-listpack-entries <n>] [--set-max-listpack-value <bytes>]"
+                  << " [--set-max-intset-entries <n>]"
+                  << " [--zset-max-listpack-entries <n>] [--zset-max-listpack-value <bytes>]"
+                  << " [--maxmemory <bytes[kb|mb|gb]>] [--maxmemory-policy <policy>] [--maxmemory-samples <n>]"
+                  << std::endl;
+    }
+
+    bool parseOptions(int argc, char *argv[], Options &options) {
+        for (int i = 1; i < argc; i++) {
+            std::string arg = argv[i];
+            if (arg == "--port" && i + 1 < argc) {
+                options.port = static_cast<short>(std::atoi(argv[++i]));
+            } else if (arg == "--threads" && i + 1 < argc) {
+                options.threads = static_cast<unsigned int>(std::atoi(argv[++i]));
+            } else if (arg == "--thread-per-core") {
+                options.thread_per_core = true;
+            } else if (arg == "--shared-nothing") {
+                options.shared_nothing = true;
+            } else if (arg == "--hash-max-listpack-entries" && i + 1 < argc) {
+                options.encoding_limits.hash_max_listpack_entries = std::strtoul(argv[++i], nullptr, 10);
+            } else if (arg == "--hash-max-listpack-value" && i + 1 < argc) {
+                options.encoding_limits.hash_max_listpack_value = std::strtoul(argv[++i], nullptr, 10);
+            } else if (arg == "--set-max-listpack-entries" && i + 1 < argc) {
+                options.encoding_limits.set_max_listpack_entries = std::strtoul(argv[++i], nullptr, 10);
+            } else if (arg == "--set-max-listpack-value" && i + 1 < argc) {
+                options.encoding_limits.set_max_listpack_value = std::strtoul(argv[++i], nullptr, 10);
+            } else if (arg == "--set-max-intset-entries" && i + 1 < argc) {
+                options.encoding_limits.set_max_intset_entries = std::strtoul(argv[++i], nullptr, 10);
+            } else if (arg == "--zset-max-listpack-entries" && i + 1 < argc) {
+                options.encoding_limits.zset_max_listpack_entries = std::strtoul(argv[++i], nullptr, 10);
+            } else if (arg == "--zset-max-listpack-value" && i + 1 < argc) {
+                options.encoding_limits.zset_max_listpack_value = std::strtoul(argv[++i], nullptr, 10);
+            } else if (arg == "--maxmemory" && i + 1 < argc) {
+                if (!parseMemory(argv[++i], options.maxmemory)) {
+                    return false;
+                }
+            } else if (arg == "--maxmemory-policy" && i + 1 < argc) {
+                if (!Database::parse_eviction_policy(argv[++i], options.maxmemory_policy)) {
+                    return false;
+                }
+            } else if (arg == "--maxmemory-samples" && i + 1 < argc) {
+                options.maxmemory_samples = std::strtoul(argv[++i], nullptr, 10);
+            } else {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Best effort: keeps a loop's handlers and data on one core's caches
+    void pinToCore(unsigned int core) {
+#ifdef __linux__
+        cpu_set_t cpus;
+        CPU_ZERO(&cpus);
+        CPU_SET(core % CPU_SETSIZE, &cpus);
+        pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus);
+#else
+        (void)core;
+#endif
+    }
+
+    // All threads run one shared io_context; any thread may run any session.
+    void runSharedPool(const Options &options, unsigned int thread_count, Database &db) {
         boost::asio::io_context io_context;
 
         // Create a work guard to keep the io_context running
         boost::asio::executor_work_guard<boost::asio::io_context::executor_type>
         work_guard = boost::asio::make_work_guard(io_context);
 
-        // Create a thread pool
-        std::vector<std::thread> thread_pool;
-        unsigned int thread_count = std::thread::hardware_concurrency();
-        thread_count = thread_count > 1 ? thread_count : 2; // Ensure at least 2 threads
-
-        Database db;
-
-        Server server(io_context, 6379, db);
+        Server server(io_context, options.port, db);
+        Cron cron(io_context, db);
 
-        // std::cout << "Server started at port 6379" << std::endl;
-        std::cout << "Server started at port 6379 with " << thread_count << " threads" << std::endl;
+        std::cout << "Server started at port " << options.port << " with " << thread_count << " threads" << std::endl;
         // Start the thread pool
+        std::vector<std::thread> thread_pool;
         thread_pool.reserve(thread_count);
         for (unsigned int i = 0; i < thread_count; i++) {
             thread_pool.emplace_back([&io_context]() {
@@ -37,11 +141,137 @@ int main() {
         for (std::thread &thread : thread_pool) {
             thread.join();
         }
-        // io_context.run();
+    }
+
+    void runLoops(std::vector<std::unique_ptr<boost::asio::io_context>> &loops) {
+        std::vector<std::thread> threads;
+        threads.reserve(loops.size());
+        for (std::size_t i = 0; i < loops.size(); i++) {
+            threads.emplace_back([&loops, i]() {
+                pinToCore(static_cast<unsigned int>(i));
+                auto work_guard = boost::asio::make_work_guard(*loops[i]);
+                loops[i]->run();
+            });
+        }
+
+        for (std::thread &thread : threads) {
+            thread.join();
+        }
+    }
+
+    std::vector<std::unique_ptr<boost::asio::io_context>> makeLoops(unsigned int thread_count) {
+        std::vector<std::unique_ptr<boost::asio::io_context>> loops;
+        for (unsigned int i = 0; i < thread_count; i++) {
+            // Concurrency hint 1: each context is only ever run by one thread
+            loops.push_back(std::make_unique<boost::asio::io_context>(1));
+        }
+        return loops;
+    }
+
+    // One single-threaded io_context per core. Each loop owns an SO_REUSEPORT
+    // acceptor, so the kernel spreads connections and a session never leaves
+    // the loop (and core) that accepted it. Without SO_REUSEPORT a single
+    // acceptor hands sockets out round-robin to the loops instead.
+    void runThreadPerCore(const Options &options, unsigned int thread_count, Database &db) {
+        auto loops = makeLoops(thread_count);
+        std::vector<boost::asio::io_context *> loop_ptrs;
+        for (auto &loop : loops) {
+            loop_ptrs.push_back(loop.get());
+        }
+
+        std::vector<std::unique_ptr<Server>> servers;
+        if (Server::reusePortSupported()) {
+            for (auto &loop : loops) {
+                servers.push_back(std::make_unique<Server>(*loop, options.port, db, true));
+            }
+        } else {
+            servers.push_back(std::make_unique<Server>(*loops[0], options.port, db, false, loop_ptrs));
+        }
+
+        Cron cron(*loops[0], db);
+
+        std::cout << "Server started at port " << options.port << " with " << thread_count
+                  << " thread-per-core event loops" << std::endl;
+        runLoops(loops);
+    }
+
+    // Thread-per-core loops where each core also owns a private, lock-free
+    // partition of the keyspace. Commands on keys owned by another core are
+    // forwarded to it over SPSC mailboxes and the reply comes back the same way.
+    void runSharedNothing(const Options &options, unsigned int thread_count) {
+        auto loops = makeLoops(thread_count);
+        std::vector<boost::asio::io_context *> loop_ptrs;
+        for (auto &loop : loops) {
+            loop_ptrs.push_back(loop.get());
+        }
+        ShardSet shards(loop_ptrs);
+        for (std::size_t i = 0; i < shards.size(); i++) {
+            shards.shard(i).database().set_encoding_limits(options.encoding_limits);
+            // Keys hash evenly across shards, so each gets an equal share
+            shards.shard(i).database().set_maxmemory(options.maxmemory / shards.size(), options.maxmemory_policy,
+                                                     options.maxmemory_samples);
+        }
+
+        std::vector<std::unique_ptr<Server>> servers;
+        if (Server::reusePortSupported()) {
+            for (std::size_t i = 0; i < shards.size(); i++) {
+                servers.push_back(std::make_unique<Server>(*loops[i], options.port,
+                                                           std::vector<Shard *>{&shards.shard(i)}, true));
+            }
+        } else {
+            std::vector<Shard *> all;
+            for (std::size_t i = 0; i < shards.size(); i++) {
+                all.push_back(&shards.shard(i));
+            }
+            servers.push_back(std::make_unique<Server>(*loops[0], options.port, all, false));
+        }
+
+        // Each shard maintains its own partition on its own loop
+        std::vector<std::unique_ptr<Cron>> crons;
+        for (std::size_t i = 0; i < shards.size(); i++) {
+            crons.push_back(std::make_unique<Cron>(*loops[i], shards.shard(i).database()));
+        }
+
+        std::cout << "Server started at port " << options.port << " with " << thread_count
+                  << " shared-nothing shards" << std::endl;
+        runLoops(loops);
+    }
+
+}
+
+// Main function to start the server
+int main(int argc, char *argv[]) {
+    Options options;
+    if (!parseOptions(argc, argv, options)) {
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    try {
+        unsigned int thread_count = options.threads;
+        if (thread_count == 0) {
+            thread_count = std::thread::hardware_concurrency();
+            thread_count = thread_count > 1 ? thread_count : 2; // Ensure at least 2 threads
+        }
+
+        if (options.shared_nothing) {
+            runSharedNothing(options, thread_count);
+            return 0;
+        }
+
+        Database db;
+        db.set_encoding_limits(options.encoding_limits);
+        db.set_maxmemory(options.maxmemory, options.maxmemory_policy, options.maxmemory_samples);
+
+        if (options.thread_per_core) {
+            runThreadPerCore(options, thread_count, db);
+        } else {
+            runSharedPool(options, thread_count, db);
+        }
     }catch (std::exception& e) {
         std::cerr << "Exception : " << e.what() << std::endl;
     }
     return 0;
 }
 
-#endif
\ No newline at end of file
+#endif
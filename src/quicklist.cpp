@@ -0,0 +1,71 @@
+//
+// List encoding: a linked sequence of packed listpack blocks.
+//
+
+#include "quicklist.h"
+
+bool QuickList::fits(const ListPack &node, std::string_view value) {
+    return node.bytes() + ListPack::encoded_size(value.size()) <= max_node_bytes;
+}
+
+void QuickList::push_front(std::string_view value) {
+    if (nodes_.empty() || !fits(nodes_.front(), value)) {
+        nodes_.emplace_front();
+    }
+    nodes_.front().push_front(value);
+    bytes_ += ListPack::encoded_size(value.size());
+    ++count_;
+}
+
+void QuickList::push_back(std::string_view value) {
+    if (nodes_.empty() || !fits(nodes_.back(), value)) {
+        nodes_.emplace_back();
+    }
+    nodes_.back().push_back(value);
+    bytes_ += ListPack::encoded_size(value.size());
+    ++count_;
+}
+
+bool QuickList::pop_front(std::string &out) {
+    if (count_ == 0) {
+        return false;
+    }
+    out.assign(front());
+    return pop_front();
+}
+
+bool QuickList::pop_back(std::string &out) {
+    if (count_ == 0) {
+        return false;
+    }
+    out.assign(back());
+    return pop_back();
+}
+
+bool QuickList::pop_front() {
+    if (count_ == 0) {
+        return false;
+    }
+    ListPack &node = nodes_.front();
+    bytes_ -= ListPack::encoded_size(node.front().size());
+    node.pop_front();
+    if (node.empty()) {
+        nodes_.pop_front();
+    }
+    --count_;
+    return true;
+}
+
+bool QuickList::pop_back() {
+    if (count_ == 0) {
+        return false;
+    }
+    ListPack &node = nodes_.back();
+    bytes_ -= ListPack::encoded_size(node.back().size());
+    node.pop_back();
+    if (node.empty()) {
+        nodes_.pop_back();
+    }
+    --count_;
+    return true;
+}
@@ -0,0 +1,106 @@
+//
+// Reply serialization shared by every command.
+//
+
+#include "reply.h"
+
+ReplyBuilder::ReplyBuilder(std::string &out, Protocol protocol, std::vector<ReplySplice> *splices)
+    : out_(out), protocol_(protocol), splices_(splices) {}
+
+void ReplyBuilder::begin_element() {
+    if (protocol_ == Protocol::Inline && pending_elements_ > 0 && !first_element_) {
+        out_ += ' ';
+    }
+    first_element_ = false;
+}
+
+void ReplyBuilder::end_element() {
+    if (protocol_ == Protocol::Resp) {
+        out_ += "\r\n";
+        return;
+    }
+    if (pending_elements_ > 0) {
+        // Inside an array: the line is terminated after the last element
+        if (--pending_elements_ > 0) {
+            return;
+        }
+    }
+    out_ += "\r\n";
+}
+
+void ReplyBuilder::status(std::string_view message) {
+    begin_element();
+    if (protocol_ == Protocol::Resp) {
+        out_ += '+';
+    }
+    out_ += message;
+    end_element();
+}
+
+void ReplyBuilder::error(std::string_view message) {
+    begin_element();
+    if (protocol_ == Protocol::Resp) {
+        out_ += '-';
+    }
+    out_ += message;
+    end_element();
+}
+
+void ReplyBuilder::integer(long long value) {
+    begin_element();
+    if (protocol_ == Protocol::Resp) {
+        out_ += ':';
+    }
+    out_ += std::to_string(value);
+    end_element();
+}
+
+void ReplyBuilder::bulk(std::string_view value) {
+    begin_element();
+    if (protocol_ == Protocol::Resp) {
+        out_ += '$';
+        out_ += std::to_string(value.size());
+        out_ += "\r\n";
+    }
+    out_ += value;
+    end_element();
+}
+
+void ReplyBuilder::bulk(const SharedBuffer &value) {
+    if (splices_ == nullptr) {
+        bulk(value.view());
+        return;
+    }
+    begin_element();
+    if (protocol_ == Protocol::Resp) {
+        out_ += '$';
+        out_ += std::to_string(value.size());
+        out_ += "\r\n";
+    }
+    splices_->push_back({out_.size(), value});
+    end_element();
+}
+
+void ReplyBuilder::null() {
+    begin_element();
+    out_ += protocol_ == Protocol::Resp ? "$-1" : "NULL";
+    end_element();
+}
+
+void ReplyBuilder::array(std::size_t length) {
+    if (protocol_ == Protocol::Resp) {
+        out_ += '*';
+        out_ += std::to_string(length);
+        out_ += "\r\n";
+        return;
+    }
+    if (length == 0) {
+        // An empty array still terminates its (empty) line
+        begin_element();
+        end_element();
+        return;
+    }
+    begin_element();
+    pending_elements_ = length;
+    first_element_ = true;
+}
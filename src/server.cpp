@@ -4,21 +4,81 @@
 
 #include "server.h"
 #include "session.h"
+#include "shard.h"
 #include<memory>
 
-Server::Server(boost::asio::io_context &io_context, short port, Database &db)
-    : acceptor_(io_context, tcp::endpoint(tcp::v4(), port)), db_(db) {
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/socket.h>
+#endif
+
+namespace {
+
+    tcp::acceptor makeAcceptor(boost::asio::io_context &io_context, short port, bool reuse_port) {
+        tcp::endpoint endpoint(tcp::v4(), port);
+        if (!reuse_port) {
+            return tcp::acceptor(io_context, endpoint);
+        }
+
+        tcp::acceptor acceptor(io_context);
+        acceptor.open(endpoint.protocol());
+        acceptor.set_option(tcp::acceptor::reuse_address(true));
+#ifdef SO_REUSEPORT
+        using reuse_port_option = boost::asio::detail::socket_option::boolean<SOL_SOCKET, SO_REUSEPORT>;
+        acceptor.set_option(reuse_port_option(true));
+#endif
+        acceptor.bind(endpoint);
+        acceptor.listen();
+        return acceptor;
+    }
+
+}
+
+Server::Server(boost::asio::io_context &io_context, short port, Database &db, bool reuse_port,
+               std::vector<boost::asio::io_context *> session_contexts)
+    : acceptor_(makeAcceptor(io_context, port, reuse_port)) {
+    if (session_contexts.empty()) {
+        session_contexts.push_back(&io_context);
+    }
+    for (auto *context : session_contexts) {
+        targets_.push_back({context, &db, nullptr});
+    }
     doAccept();
 }
 
+Server::Server(boost::asio::io_context &io_context, short port, const std::vector<Shard *> &shards, bool reuse_port)
+    : acceptor_(makeAcceptor(io_context, port, reuse_port)) {
+    for (auto *shard : shards) {
+        targets_.push_back({&shard->loop(), &shard->database(), shard});
+    }
+    doAccept();
+}
+
+bool Server::reusePortSupported() {
+#ifdef SO_REUSEPORT
+    return true;
+#else
+    return false;
+#endif
+}
+
+unsigned short Server::port() const {
+    return acceptor_.local_endpoint().port();
+}
+
 void Server::doAccept() {
+    const Target &target = targets_[next_target_++ % targets_.size()];
+    // Each socket gets its own strand: a loop may be run by several threads,
+    // and a session's read and write handlers share its buffers
+    auto strand = boost::asio::make_strand(*target.loop);
     acceptor_.async_accept(
-        [this](boost::system::error_code ec, tcp::socket socket) {
+        strand,
+        [this, target, strand](boost::system::error_code ec, tcp::socket socket) {
             if (!ec) {
-                std::make_shared<Session>(std::move(socket), db_)->start();
+                // The session stays pinned to the strand that owns its socket
+                auto session = std::make_shared<Session>(std::move(socket), *target.db, target.shard);
+                boost::asio::post(strand, [session]() { session->start(); });
             }
             doAccept();
         }
     );
 }
-
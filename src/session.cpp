@@ -5,74 +5,260 @@
 #include "session.h"
 #include "command_handler.h"
 #include "command_parser.h"
+#include "reply.h"
+#include "shard.h"
+#include <algorithm>
+#include <cstring>
 #include <iostream>
 
-Session::Session(tcp::socket socket, Database& db)
-    : socket_(std::move(socket)), db_(db) {}
+Session::Session(tcp::socket socket, Database& db, Shard* shard)
+    : socket_(std::move(socket)), db_(db), shard_(shard) {}
 
 void Session::start() {
-    std::flush(std::cout);
-    doWrite("> ");
+    // No greeting prompt: a RESP client would read it as a reply
     doRead();
 }
 
+// The session has exactly one outstanding read at a time. Writes never start
+// reads; the loop is paused while a slow client has too much unsent output,
+// and while a forwarded command is out, so that input_ never moves under a
+// pending read.
 void Session::doRead() {
     auto self(shared_from_this());
+    // Data goes straight where it is parsed from: a large final argument into
+    // its own string, everything else into the free space of input_
+    bool into_payload = payload_pending_ && payload_received_ < payload_.size();
+    boost::asio::mutable_buffer target = into_payload
+        ? boost::asio::buffer(&payload_[payload_received_], payload_.size() - payload_received_)
+        : boost::asio::buffer(input_.prepare(min_read), input_.writable());
     socket_.async_read_some(
-        boost::asio::buffer(data_, max_length),
-        [this, self](boost::system::error_code ec, std::size_t length) {
-            if (!ec) {
-                // Append received data to buffer
-                buffer_.append(data_, length);
-
-                // Process complete commands
-                size_t pos;
-                while ((pos = buffer_.find("\r\n")) != std::string::npos ||
-                       (pos = buffer_.find("\n")) != std::string::npos) {
-
-                    // Extract the command (exclude the newline)
-                    std::string command = buffer_.substr(0, pos);
-
-                    // Remove the processed command from buffer (including newline)
-                    size_t chars_to_remove = pos;
-                    if (buffer_[pos] == '\r' && pos + 1 < buffer_.length() && buffer_[pos + 1] == '\n') {
-                        chars_to_remove += 2;  // \r\n case
-                    } else {
-                        chars_to_remove += 1;  // \n case
-                    }
-                    buffer_.erase(0, chars_to_remove);
+        target,
+        [this, self, into_payload](boost::system::error_code ec, std::size_t length) {
+            if (ec) {
+                return;
+            }
+            if (into_payload) {
+                payload_received_ += length;
+            } else {
+                input_.commit(length);
+            }
+            if (!awaiting_remote_ && !(payload_pending_ && payload_received_ < payload_.size())) {
+                processInput();
+            }
+
+            if (closing_) {
+                return;
+            }
+            if (queued_bytes_ > max_output_backlog || awaiting_remote_) {
+                read_paused_ = true;
+                return;
+            }
+            doRead();
+        }
+    );
+}
 
-                    // Process the command if it's not empty
-                    if (!command.empty()) {
-                        auto tokens = parseCommand(command);
-                        std::string response = handleCommand(tokens, db_) + "\r\n";
+void Session::resumeReading() {
+    if (read_paused_ && !closing_ && queued_bytes_ <= max_output_backlog && !awaiting_remote_) {
+        read_paused_ = false;
+        doRead();
+    }
+}
 
-                        // Send response
-                        doWrite(response);
-                        doWrite("> ");
-                        return;  // Return after processing one command
+void Session::onRemoteReply(std::string reply) {
+    awaiting_remote_ = false;
+    // Pick up the commands that arrived behind the forwarded one
+    processInput(std::move(reply), remote_prompt_);
+    resumeReading();
+}
+
+void Session::processInput(std::string response, bool prompt) {
+    // Execute every complete command in the buffer, gathering the
+    // replies so the whole batch is queued as one buffer
+    if (response.empty() && !spare_buffers_.empty()) {
+        response = std::move(spare_buffers_.back());
+        spare_buffers_.pop_back();
+    }
+    std::vector<ReplySplice> splices; // large values sent in place, see ReplyBuilder
+    std::size_t offset = 0;
+    while (true) {
+        std::string_view input = input_.data().substr(offset);
+        ParseResult parsed;
+        if (payload_pending_) {
+            // The request's last argument went to payload_; input has the rest
+            if (payload_received_ < payload_.size()) {
+                break;
+            }
+            parsed = parseCommandWithLast(input, payload_head_, payload_, tokens_, parse_state_);
+        } else {
+            parsed = parseCommand(input, tokens_, parse_state_);
+        }
+        if (parsed.status == ParseStatus::Incomplete) {
+            if (!payload_pending_ && parsed.pending_bulk_last && parsed.pending_bulk_length >= direct_read_min) {
+                startPayload(offset, parsed);
+            }
+            break;
+        }
+
+        if (parsed.status == ParseStatus::Error) {
+            // The stream cannot be resynchronised, reply and hang up
+            ReplyBuilder reply(response, parsed.protocol);
+            reply.error("ERR " + std::string(parsed.error));
+            closing_ = true;
+            prompt = false;
+            break;
+        }
+
+        offset += parsed.consumed;
+        bool with_payload = payload_pending_;
+        payload_pending_ = false;
+        payload_received_ = 0;
+
+        // Process the command if it's not empty. Tokens are views into
+        // input_ (and payload_); they are only copied when the command
+        // leaves this thread.
+        if (!tokens_.empty()) {
+            CommandArgs args(tokens_, with_payload ? &payload_ : nullptr);
+            if (shard_ != nullptr) {
+                std::size_t owner = shard_->route(tokens_);
+                if (owner == Shard::cross_shard) {
+                    ReplyBuilder reply(response, parsed.protocol);
+                    reply.error("CROSSSLOT Keys in request don't hash to the same shard");
+                    prompt = parsed.protocol == Protocol::Inline;
+                    continue;
+                }
+                if (owner == Shard::all_shards) {
+                    // Run it here, then around the other shards; their last reply answers
+                    std::string local;
+                    ReplyBuilder local_reply(local, parsed.protocol);
+                    handleCommand(args, db_, local_reply);
+                    if (shard_->forwardToOthers(owned_command(args), parsed.protocol, shared_from_this())) {
+                        awaiting_remote_ = true;
+                        remote_prompt_ = parsed.protocol == Protocol::Inline;
+                        break;
                     }
+                    response += local;
+                    prompt = parsed.protocol == Protocol::Inline;
+                    continue;
+                }
+                if (owner != shard_->id()) {
+                    // Replies must stay in order, so stop here until this one is back
+                    awaiting_remote_ = true;
+                    remote_prompt_ = parsed.protocol == Protocol::Inline;
+                    shard_->forward(owner, owned_command(args), parsed.protocol, shared_from_this());
+                    break;
                 }
-
-                // Continue reading if no complete command was found
-                doRead();
             }
+            ReplyBuilder reply(response, parsed.protocol, &splices);
+            handleCommand(args, db_, reply);
+            prompt = parsed.protocol == Protocol::Inline;
         }
-    );
+    }
+    // Consumed requests are skipped, not moved
+    input_.consume(offset);
+    if (!payload_pending_ && !payload_.empty()) {
+        std::string().swap(payload_); // an argument the command did not keep
+    }
+
+    if (prompt && !awaiting_remote_) {
+        response += "> ";
+    }
+    if (!response.empty() || !splices.empty()) {
+        queueReply(std::move(response), std::move(splices));
+    } else {
+        recycle(std::move(response));
+        if (closing_ && !writing_) {
+            doWrite();
+        }
+    }
 }
 
-void Session::doWrite(const std::string& response) {
-    auto self(shared_from_this());
-    // Store the response in the member variable
-    write_buffer_ = response;
+void Session::startPayload(std::size_t offset, const ParseResult &parsed) {
+    // Move whatever part of the argument already arrived and read the rest
+    // in place. Only its terminating CRLF stays behind in input_.
+    std::size_t begin = offset + parsed.pending_bulk_offset;
+    std::size_t arrived = std::min(input_.size() - begin, parsed.pending_bulk_length);
+    payload_.resize(parsed.pending_bulk_length);
+    std::memcpy(&payload_[0], input_.data().data() + begin, arrived);
+    input_.erase(begin, arrived);
+    payload_received_ = arrived;
+    payload_head_ = parsed.pending_bulk_offset;
+    payload_pending_ = true;
+}
+
+std::vector<std::string> Session::owned_command(const CommandArgs &args) {
+    std::vector<std::string> command;
+    command.reserve(args.size());
+    for (std::size_t i = 0; i < args.size(); i++) {
+        command.push_back(args.take(i));
+    }
+    return command;
+}
 
+void Session::recycle(std::string buffer) {
+    if (spare_buffers_.size() < max_spare_buffers && buffer.capacity() <= max_spare_capacity) {
+        buffer.clear();
+        spare_buffers_.push_back(std::move(buffer));
+    }
+}
+
+void Session::queueReply(std::string reply, std::vector<ReplySplice> splices) {
+    queued_bytes_ += reply.size();
+    for (const auto &splice : splices) {
+        queued_bytes_ += splice.buffer.size();
+    }
+    output_queue_.push_back({std::move(reply), std::move(splices)});
+    if (!writing_) {
+        doWrite();
+    }
+}
+
+void Session::doWrite() {
+    if (output_queue_.empty()) {
+        if (closing_) {
+            boost::system::error_code ignored;
+            socket_.shutdown(tcp::socket::shutdown_both, ignored);
+            socket_.close(ignored);
+        }
+        return;
+    }
+
+    // Hand everything queued so far to a single gathered write (writev)
+    in_flight_.swap(output_queue_);
+    write_buffers_.clear();
+    for (const auto &reply : in_flight_) {
+        std::size_t position = 0;
+        for (const auto &splice : reply.splices) {
+            if (splice.offset > position) {
+                write_buffers_.emplace_back(boost::asio::buffer(reply.bytes.data() + position, splice.offset - position));
+            }
+            write_buffers_.emplace_back(boost::asio::buffer(splice.buffer.data(), splice.buffer.size()));
+            position = splice.offset;
+        }
+        if (position < reply.bytes.size()) {
+            write_buffers_.emplace_back(boost::asio::buffer(reply.bytes.data() + position, reply.bytes.size() - position));
+        }
+    }
+
+    writing_ = true;
+    auto self(shared_from_this());
     boost::asio::async_write(
         socket_,
-        boost::asio::buffer(write_buffer_),
-        [this, self](boost::system::error_code ec, std::size_t /*length*/) {
-            if (!ec) {
-                doRead(); // Wait for the next command
+        write_buffers_,
+        [this, self](boost::system::error_code ec, std::size_t length) {
+            writing_ = false;
+            queued_bytes_ -= length;
+            // Keep the written buffers for the next replies, and let go of
+            // the shared values spliced in now rather than at the next write
+            for (auto &reply : in_flight_) {
+                recycle(std::move(reply.bytes));
             }
+            in_flight_.clear();
+            if (ec) {
+                return;
+            }
+            doWrite(); // flush replies queued while this write was in flight
+            resumeReading();
         }
     );
-}
\ No newline at end of file
+}
@@ -0,0 +1,136 @@
+//
+// Set value with compact encodings for small and all-integer sets.
+//
+
+#include "set_object.h"
+#include "memory_usage.h"
+#include <algorithm>
+
+namespace {
+
+    std::size_t decimal_length(std::int64_t value) {
+        char digits[24];
+        return std::to_chars(digits, digits + sizeof(digits), value).ptr - digits;
+    }
+
+}
+
+const char *SetObject::encoding_name() const {
+    if (std::holds_alternative<IntSet>(data_)) {
+        return "intset";
+    }
+    return std::holds_alternative<ListPack>(data_) ? "listpack" : "hashtable";
+}
+
+std::size_t SetObject::size() const {
+    if (auto *ints = std::get_if<IntSet>(&data_)) {
+        return ints->size();
+    }
+    if (auto *pack = std::get_if<ListPack>(&data_)) {
+        return pack->size();
+    }
+    return std::get<Table>(data_).size();
+}
+
+std::size_t SetObject::memory_usage() const {
+    if (auto *ints = std::get_if<IntSet>(&data_)) {
+        return ints->bytes();
+    }
+    if (auto *pack = std::get_if<ListPack>(&data_)) {
+        return pack->bytes();
+    }
+    return std::get<Table>(data_).allocated_bytes() + payload_;
+}
+
+std::size_t SetObject::free_effort() const {
+    return std::holds_alternative<Table>(data_) ? size() : 1;
+}
+
+bool SetObject::add(std::string_view member, const EncodingLimits &limits) {
+    if (auto *ints = std::get_if<IntSet>(&data_)) {
+        std::int64_t value;
+        if (!IntSet::parse(member, value)) {
+            convert_from_intset(member, limits);
+        } else if (ints->size() < limits.set_max_intset_entries || ints->contains(value)) {
+            return ints->insert(value);
+        } else {
+            convert_to_table();
+        }
+    }
+    if (auto *pack = std::get_if<ListPack>(&data_)) {
+        if (pack->find(member) != pack->end()) {
+            return false;
+        }
+        if (pack->size() + 1 <= limits.set_max_listpack_entries &&
+            member.size() <= limits.set_max_listpack_value) {
+            pack->push_back(member);
+            return true;
+        }
+        convert_to_table();
+    }
+    if (!std::get<Table>(data_).emplace(member).second) {
+        return false;
+    }
+    payload_ += string_heap_bytes(member.size());
+    return true;
+}
+
+bool SetObject::remove(std::string_view member) {
+    if (auto *ints = std::get_if<IntSet>(&data_)) {
+        std::int64_t value;
+        return IntSet::parse(member, value) && ints->erase(value);
+    }
+    if (auto *pack = std::get_if<ListPack>(&data_)) {
+        std::size_t offset = pack->find(member);
+        if (offset == pack->end()) {
+            return false;
+        }
+        pack->erase(offset);
+        return true;
+    }
+    if (std::get<Table>(data_).erase(member) == 0) {
+        return false;
+    }
+    payload_ -= string_heap_bytes(member.size());
+    return true;
+}
+
+bool SetObject::contains(std::string_view member) const {
+    if (auto *ints = std::get_if<IntSet>(&data_)) {
+        std::int64_t value;
+        return IntSet::parse(member, value) && ints->contains(value);
+    }
+    if (auto *pack = std::get_if<ListPack>(&data_)) {
+        return pack->find(member) != pack->end();
+    }
+    return std::get<Table>(data_).count(member) > 0;
+}
+
+void SetObject::convert_from_intset(std::string_view member, const EncodingLimits &limits) {
+    const auto &ints = std::get<IntSet>(data_);
+    // The longest member printed is one of the extremes
+    std::size_t longest = ints.empty() ? member.size()
+                                       : std::max({member.size(), decimal_length(ints.front()),
+                                                   decimal_length(ints.back())});
+    if (ints.size() + 1 > limits.set_max_listpack_entries || longest > limits.set_max_listpack_value) {
+        convert_to_table();
+        return;
+    }
+    ListPack pack;
+    for_each([&pack](std::string_view existing) {
+        pack.push_back(existing);
+    });
+    data_ = std::move(pack);
+}
+
+void SetObject::convert_to_table() {
+    Table table;
+    table.reserve(size() + 1);
+    std::size_t payload = 0;
+    for_each([&table, &payload](std::string_view member) {
+        table.emplace(member);
+        payload += string_heap_bytes(member.size());
+    });
+    data_ = std::move(table);
+    payload_ = payload;
+}
@@ -0,0 +1,157 @@
+//
+// Shared-nothing keyspace partitioning for thread-per-core mode.
+//
+
+#include "shard.h"
+#include "session.h"
+#include "command_handler.h"
+#include "reply.h"
+#include <functional>
+
+Shard::Shard(ShardSet &shards, std::size_t id, boost::asio::io_context &loop)
+    : shards_(shards), id_(id), loop_(loop) {}
+
+std::size_t Shard::route(const std::vector<std::string_view> &tokens) const {
+    // Key positions come from the command table. Unknown and malformed
+    // commands run here, which is where their error reply is produced.
+    const CommandSpec *command = tokens.empty() ? nullptr : find_command(tokens[0]);
+    if (command == nullptr) {
+        return id_;
+    }
+    if (command->has(command_all_shards)) {
+        return all_shards;
+    }
+    if (command->first_key == 0 || !command->arity_ok(tokens.size()) ||
+        tokens.size() <= static_cast<std::size_t>(command->first_key)) {
+        return id_;
+    }
+    std::size_t last = command->last_key < 0 ? tokens.size() + command->last_key
+                                             : static_cast<std::size_t>(command->last_key);
+    std::size_t owner = shards_.ownerOf(tokens[command->first_key]);
+    // Multi-key commands (DEL, UNLINK, EXISTS) need all their keys on one shard
+    for (std::size_t i = command->first_key + command->key_step; i <= last && i < tokens.size();
+         i += command->key_step) {
+        if (shards_.ownerOf(tokens[i]) != owner) {
+            return cross_shard;
+        }
+    }
+    return owner;
+}
+
+void Shard::forward(std::size_t target, std::vector<std::string> command, Protocol protocol,
+                    std::shared_ptr<Session> session) {
+    auto message = std::make_unique<ShardMessage>();
+    message->command = std::move(command);
+    message->protocol = protocol;
+    message->session = std::move(session);
+    message->origin = id_;
+    send(target, std::move(message));
+}
+
+bool Shard::forwardToOthers(std::vector<std::string> command, Protocol protocol,
+                            std::shared_ptr<Session> session) {
+    if (shards_.size() == 1) {
+        return false;
+    }
+    auto message = std::make_unique<ShardMessage>();
+    message->command = std::move(command);
+    message->protocol = protocol;
+    message->session = std::move(session);
+    message->origin = id_;
+    message->broadcast = true;
+    send((id_ + 1) % shards_.size(), std::move(message));
+    return true;
+}
+
+void Shard::send(std::size_t target, std::unique_ptr<ShardMessage> message) {
+    auto &backlog = backlog_[target];
+    if (!backlog.empty() || !shards_.mailbox(id_, target).try_push(message)) {
+        // Mailbox full: keep ordering by queueing behind what is already waiting
+        backlog.push_back(std::move(message));
+        if (!backlog_retry_scheduled_) {
+            backlog_retry_scheduled_ = true;
+            boost::asio::post(loop_, [this]() { flushBacklog(); });
+        }
+    }
+
+    // Ring the target's doorbell unless a drain is already pending there
+    Shard &destination = shards_.shard(target);
+    if (!destination.drain_scheduled_.exchange(true)) {
+        boost::asio::post(destination.loop_, [&destination]() { destination.drain(); });
+    }
+}
+
+void Shard::flushBacklog() {
+    backlog_retry_scheduled_ = false;
+    bool pending = false;
+    for (std::size_t target = 0; target < backlog_.size(); target++) {
+        auto &backlog = backlog_[target];
+        auto &mailbox = shards_.mailbox(id_, target);
+        bool pushed = false;
+        while (!backlog.empty() && mailbox.try_push(backlog.front())) {
+            backlog.pop_front();
+            pushed = true;
+        }
+        if (!backlog.empty()) {
+            pending = true;
+        }
+        Shard &destination = shards_.shard(target);
+        if (pushed && !destination.drain_scheduled_.exchange(true)) {
+            boost::asio::post(destination.loop_, [&destination]() { destination.drain(); });
+        }
+    }
+    if (pending) {
+        backlog_retry_scheduled_ = true;
+        boost::asio::post(loop_, [this]() { flushBacklog(); });
+    }
+}
+
+void Shard::drain() {
+    // Clear the flag first: anything pushed from now on rings the doorbell again
+    drain_scheduled_.store(false);
+    std::unique_ptr<ShardMessage> message;
+    for (std::size_t from = 0; from < shards_.size(); from++) {
+        auto &mailbox = shards_.mailbox(from, id_);
+        while (mailbox.try_pop(message)) {
+            handle(std::move(message));
+        }
+    }
+}
+
+void Shard::handle(std::unique_ptr<ShardMessage> message) {
+    if (message->command.empty()) {
+        // A reply to one of our own sessions
+        auto session = std::move(message->session);
+        session->onRemoteReply(std::move(message->reply));
+        return;
+    }
+
+    tokens_.assign(message->command.begin(), message->command.end());
+    ReplyBuilder reply(message->reply, message->protocol);
+    handleCommand(tokens_, db_, reply);
+    std::size_t next = (id_ + 1) % shards_.size();
+    if (message->broadcast && next != message->origin) {
+        message->reply.clear(); // only the last shard's reply goes back
+        send(next, std::move(message));
+        return;
+    }
+    message->command.clear();
+    std::size_t origin = message->origin;
+    send(origin, std::move(message));
+}
+
+ShardSet::ShardSet(const std::vector<boost::asio::io_context *> &loops) {
+    for (std::size_t i = 0; i < loops.size(); i++) {
+        shards_.push_back(std::make_unique<Shard>(*this, i, *loops[i]));
+    }
+    for (auto &shard : shards_) {
+        shard->backlog_.resize(loops.size());
+    }
+    for (std::size_t i = 0; i < loops.size() * loops.size(); i++) {
+        mailboxes_.push_back(std::make_unique<Mailbox>(mailbox_capacity));
+    }
+}
+
+std::size_t ShardSet::ownerOf(std::string_view key) const {
+    return std::hash<std::string_view>{}(key) % shards_.size();
+}
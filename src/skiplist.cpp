@@ -0,0 +1,218 @@
+//
+// Skiplist ordering sorted-set members by (score, member), with rank spans.
+//
+
+#include "skiplist.h"
+#include "memory_usage.h"
+#include "slab_allocator.h"
+#include <new>
+#include <random>
+#include <utility>
+
+SkipList::SkipList() : header_(create_node(max_level, 0, {})) {}
+
+SkipList::~SkipList() {
+    release();
+}
+
+SkipList::SkipList(SkipList &&other) noexcept
+    : header_(create_node(max_level, 0, {})) {
+    *this = std::move(other);
+}
+
+SkipList &SkipList::operator=(SkipList &&other) noexcept {
+    std::swap(header_, other.header_);
+    std::swap(tail_, other.tail_);
+    std::swap(length_, other.length_);
+    std::swap(bytes_, other.bytes_);
+    std::swap(level_, other.level_);
+    return *this;
+}
+
+void SkipList::release() {
+    if (header_ == nullptr) {
+        return;
+    }
+    Node *node = header_->levels()[0].forward;
+    while (node != nullptr) {
+        Node *next = node->levels()[0].forward;
+        destroy_node(node);
+        node = next;
+    }
+    destroy_node(header_);
+    header_ = nullptr;
+}
+
+SkipList::Node *SkipList::create_node(int height, double score, std::string_view member) {
+    void *memory = SlabAllocator::allocate(sizeof(Node) + height * sizeof(Node::Level));
+    Node *node = new (memory) Node(score, member, height);
+    for (int i = 0; i < height; i++) {
+        node->levels()[i] = {nullptr, 0};
+    }
+    return node;
+}
+
+std::size_t SkipList::node_bytes(int height, std::size_t member_length) {
+    return sizeof(Node) + height * sizeof(Node::Level) + string_heap_bytes(member_length);
+}
+
+void SkipList::destroy_node(Node *node) {
+    std::size_t size = sizeof(Node) + node->height_ * sizeof(Node::Level);
+    node->~Node();
+    SlabAllocator::deallocate(node, size);
+}
+
+int SkipList::random_level() {
+    // Each level is kept with probability 1/4, as in Redis
+    thread_local std::minstd_rand rng(std::random_device{}());
+    int level = 1;
+    while (level < max_level && (rng() & 3) == 0) {
+        ++level;
+    }
+    return level;
+}
+
+bool SkipList::before(const Node *node, double score, std::string_view member) {
+    return node->score_ < score || (node->score_ == score && std::string_view(node->member_) < member);
+}
+
+void SkipList::insert(double score, std::string_view member) {
+    Node *update[max_level];
+    std::size_t rank[max_level];
+
+    Node *node = header_;
+    for (int i = level_ - 1; i >= 0; i--) {
+        rank[i] = i == level_ - 1 ? 0 : rank[i + 1];
+        while (node->levels()[i].forward != nullptr && before(node->levels()[i].forward, score, member)) {
+            rank[i] += node->levels()[i].span;
+            node = node->levels()[i].forward;
+        }
+        update[i] = node;
+    }
+
+    int height = random_level();
+    if (height > level_) {
+        for (int i = level_; i < height; i++) {
+            rank[i] = 0;
+            update[i] = header_;
+            update[i]->levels()[i].span = length_;
+        }
+        level_ = height;
+    }
+
+    Node *created = create_node(height, score, member);
+    for (int i = 0; i < height; i++) {
+        created->levels()[i].forward = update[i]->levels()[i].forward;
+        update[i]->levels()[i].forward = created;
+        // update[i] now reaches the new node, which takes over the rest of the span
+        created->levels()[i].span = update[i]->levels()[i].span - (rank[0] - rank[i]);
+        update[i]->levels()[i].span = (rank[0] - rank[i]) + 1;
+    }
+    // Higher levels pass over the new node
+    for (int i = height; i < level_; i++) {
+        update[i]->levels()[i].span++;
+    }
+
+    created->backward_ = update[0] == header_ ? nullptr : update[0];
+    if (created->levels()[0].forward != nullptr) {
+        created->levels()[0].forward->backward_ = created;
+    } else {
+        tail_ = created;
+    }
+    length_++;
+    bytes_ += node_bytes(height, member.size());
+}
+
+bool SkipList::erase(double score, std::string_view member) {
+    Node *update[max_level];
+    Node *node = header_;
+    for (int i = level_ - 1; i >= 0; i--) {
+        while (node->levels()[i].forward != nullptr && before(node->levels()[i].forward, score, member)) {
+            node = node->levels()[i].forward;
+        }
+        update[i] = node;
+    }
+
+    node = node->levels()[0].forward;
+    if (node == nullptr || node->score_ != score || node->member_ != member) {
+        return false;
+    }
+
+    for (int i = 0; i < level_; i++) {
+        if (update[i]->levels()[i].forward == node) {
+            update[i]->levels()[i].span += node->levels()[i].span - 1;
+            update[i]->levels()[i].forward = node->levels()[i].forward;
+        } else {
+            update[i]->levels()[i].span--;
+        }
+    }
+    if (node->levels()[0].forward != nullptr) {
+        node->levels()[0].forward->backward_ = node->backward_;
+    } else {
+        tail_ = node->backward_;
+    }
+    while (level_ > 1 && header_->levels()[level_ - 1].forward == nullptr) {
+        level_--;
+    }
+    length_--;
+    bytes_ -= node_bytes(node->height_, member.size());
+    destroy_node(node);
+    return true;
+}
+
+std::size_t SkipList::rank(double score, std::string_view member) const {
+    std::size_t traversed = 0;
+    const Node *node = header_;
+    for (int i = level_ - 1; i >= 0; i--) {
+        while (node->levels()[i].forward != nullptr && before(node->levels()[i].forward, score, member)) {
+            traversed += node->levels()[i].span;
+            node = node->levels()[i].forward;
+        }
+    }
+    // node is the last entry before the member, which comes right after it
+    return traversed;
+}
+
+const SkipList::Node *SkipList::at_rank(std::size_t rank) const {
+    if (rank >= length_) {
+        return nullptr;
+    }
+    // Spans count from the header, whose own position is 0
+    std::size_t target = rank + 1;
+    std::size_t traversed = 0;
+    const Node *node = header_;
+    for (int i = level_ - 1; i >= 0; i--) {
+        while (node->levels()[i].forward != nullptr && traversed + node->levels()[i].span <= target) {
+            traversed += node->levels()[i].span;
+            node = node->levels()[i].forward;
+        }
+        if (traversed == target) {
+            return node;
+        }
+    }
+    return nullptr;
+}
+
+std::size_t SkipList::lower_rank(const ScoreRange &range) const {
+    std::size_t traversed = 0;
+    const Node *node = header_;
+    for (int i = level_ - 1; i >= 0; i--) {
+        while (node->levels()[i].forward != nullptr && !range.above_min(node->levels()[i].forward->score_)) {
+            traversed += node->levels()[i].span;
+            node = node->levels()[i].forward;
+        }
+    }
+    return traversed;
+}
+
+std::size_t SkipList::upper_rank(const ScoreRange &range) const {
+    std::size_t traversed = 0;
+    const Node *node = header_;
+    for (int i = level_ - 1; i >= 0; i--) {
+        while (node->levels()[i].forward != nullptr && range.below_max(node->levels()[i].forward->score_)) {
+            traversed += node->levels()[i].span;
+            node = node->levels()[i].forward;
+        }
+    }
+    return traversed;
+}
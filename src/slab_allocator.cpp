@@ -0,0 +1,241 @@
+//
+// Size-class slab allocator with per-thread caches for keyspace objects.
+//
+
+#include "slab_allocator.h"
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <vector>
+
+namespace {
+
+    // 16-byte steps up to 128, then four classes per doubling up to 1024
+    constexpr std::size_t class_sizes[] = {
+        16, 32, 48, 64, 80, 96, 112, 128,
+        160, 192, 224, 256,
+        320, 384, 448, 512,
+        640, 768, 896, 1024,
+    };
+    constexpr std::size_t class_count = sizeof(class_sizes) / sizeof(class_sizes[0]);
+
+    std::size_t class_index(std::size_t size) {
+        if (size <= 128) {
+            return size == 0 ? 0 : (size - 1) / 16;
+        }
+        if (size <= 256) {
+            return 8 + (size - 129) / 32;
+        }
+        if (size <= 512) {
+            return 12 + (size - 257) / 64;
+        }
+        return 16 + (size - 513) / 128;
+    }
+
+    // Blocks moved between a thread cache and the central lists at a time
+    std::size_t batch_size(std::size_t index) {
+        return std::clamp<std::size_t>(SlabAllocator::slab_size / class_sizes[index] / 8, 4, 64);
+    }
+
+    struct FreeBlock {
+        FreeBlock *next;
+    };
+
+    struct FreeList {
+        FreeBlock *head = nullptr;
+        std::size_t count = 0;
+
+        void push(FreeBlock *block) {
+            block->next = head;
+            head = block;
+            count++;
+        }
+        FreeBlock *pop() {
+            FreeBlock *block = head;
+            head = block->next;
+            count--;
+            return block;
+        }
+    };
+
+    struct ThreadCache {
+        FreeList lists[class_count];
+        // Net bytes handed out by this thread. Blocks freed by another thread
+        // are subtracted there, so one thread's count can go negative.
+        // Written only by the owner; read by stats().
+        std::atomic<long long> allocated{0};
+        std::atomic<long long> requested{0};
+
+        void charge(long long block, long long asked) {
+            allocated.store(allocated.load(std::memory_order_relaxed) + block, std::memory_order_relaxed);
+            requested.store(requested.load(std::memory_order_relaxed) + asked, std::memory_order_relaxed);
+        }
+    };
+
+    struct Central {
+        struct Shelf {
+            std::mutex mutex;
+            FreeList list;
+        };
+        Shelf shelves[class_count];
+        std::atomic<std::size_t> reserved{0};
+
+        std::mutex registry_mutex;
+        std::vector<ThreadCache *> caches;
+        // Totals of exited threads and of allocations made without a cache
+        std::atomic<long long> retired_allocated{0};
+        std::atomic<long long> retired_requested{0};
+
+        // Moves up to `wanted` blocks of class `index` into `out`, carving a
+        // new slab when the shelf is empty
+        void take(std::size_t index, std::size_t wanted, FreeList &out) {
+            Shelf &shelf = shelves[index];
+            std::lock_guard<std::mutex> lock(shelf.mutex);
+            if (shelf.list.count == 0) {
+                carve(index, shelf.list);
+            }
+            while (wanted-- > 0 && shelf.list.count > 0) {
+                out.push(shelf.list.pop());
+            }
+        }
+
+        void give(std::size_t index, FreeList &from, std::size_t count) {
+            Shelf &shelf = shelves[index];
+            std::lock_guard<std::mutex> lock(shelf.mutex);
+            while (count-- > 0 && from.count > 0) {
+                shelf.list.push(from.pop());
+            }
+        }
+
+        void carve(std::size_t index, FreeList &into) {
+            std::size_t block = class_sizes[index];
+            char *slab = static_cast<char *>(::operator new(SlabAllocator::slab_size));
+            reserved.fetch_add(SlabAllocator::slab_size, std::memory_order_relaxed);
+            // Pushed in reverse so blocks are handed out in address order
+            for (std::size_t offset = SlabAllocator::slab_size / block * block; offset > 0; offset -= block) {
+                into.push(reinterpret_cast<FreeBlock *>(slab + offset - block));
+            }
+        }
+    };
+
+    // Never destroyed: thread caches may flush into it during static destruction
+    Central &central() {
+        static Central *instance = new Central();
+        return *instance;
+    }
+
+    // Trivially destructible, so they stay readable for the whole thread
+    // lifetime, including after the reaper below has run
+    thread_local ThreadCache *tls_cache = nullptr;
+    thread_local bool tls_exited = false;
+
+    // Hands a thread's cached blocks and totals back on thread exit
+    struct CacheReaper {
+        ~CacheReaper() {
+            ThreadCache *cache = tls_cache;
+            tls_exited = true;
+            tls_cache = nullptr;
+            if (cache == nullptr) {
+                return;
+            }
+            Central &shared = central();
+            for (std::size_t i = 0; i < class_count; i++) {
+                shared.give(i, cache->lists[i], cache->lists[i].count);
+            }
+            std::lock_guard<std::mutex> lock(shared.registry_mutex);
+            shared.retired_allocated.fetch_add(cache->allocated.load(), std::memory_order_relaxed);
+            shared.retired_requested.fetch_add(cache->requested.load(), std::memory_order_relaxed);
+            shared.caches.erase(std::find(shared.caches.begin(), shared.caches.end(), cache));
+            delete cache;
+        }
+    };
+    thread_local CacheReaper tls_reaper;
+
+    // This thread's cache, or nullptr once the thread is shutting down
+    ThreadCache *local_cache() {
+        if (tls_cache == nullptr && !tls_exited) {
+            (void) &tls_reaper; // constructs the reaper for this thread
+            auto *cache = new ThreadCache();
+            Central &shared = central();
+            std::lock_guard<std::mutex> lock(shared.registry_mutex);
+            shared.caches.push_back(cache);
+            tls_cache = cache;
+        }
+        return tls_cache;
+    }
+
+}
+
+std::size_t SlabAllocator::class_size(std::size_t size) {
+    return class_sizes[class_index(size)];
+}
+
+void *SlabAllocator::allocate(std::size_t size) {
+    if (size > max_size) {
+        return ::operator new(size);
+    }
+    std::size_t index = class_index(size);
+    ThreadCache *cache = local_cache();
+    if (cache == nullptr) {
+        FreeList one;
+        central().take(index, 1, one);
+        central().retired_allocated.fetch_add(class_sizes[index], std::memory_order_relaxed);
+        central().retired_requested.fetch_add(size, std::memory_order_relaxed);
+        return one.pop();
+    }
+    FreeList &list = cache->lists[index];
+    if (list.count == 0) {
+        central().take(index, batch_size(index), list);
+    }
+    cache->charge(static_cast<long long>(class_sizes[index]), static_cast<long long>(size));
+    return list.pop();
+}
+
+void SlabAllocator::deallocate(void *pointer, std::size_t size) noexcept {
+    if (pointer == nullptr) {
+        return;
+    }
+    if (size > max_size) {
+        ::operator delete(pointer);
+        return;
+    }
+    std::size_t index = class_index(size);
+    auto *block = static_cast<FreeBlock *>(pointer);
+    ThreadCache *cache = local_cache();
+    if (cache == nullptr) {
+        FreeList one;
+        one.push(block);
+        central().give(index, one, 1);
+        central().retired_allocated.fetch_sub(class_sizes[index], std::memory_order_relaxed);
+        central().retired_requested.fetch_sub(size, std::memory_order_relaxed);
+        return;
+    }
+    FreeList &list = cache->lists[index];
+    list.push(block);
+    cache->charge(-static_cast<long long>(class_sizes[index]), -static_cast<long long>(size));
+    // Keep a bounded stash; the surplus is more useful to other threads
+    std::size_t batch = batch_size(index);
+    if (list.count > 2 * batch) {
+        central().give(index, list, batch);
+    }
+}
+
+SlabAllocator::Stats SlabAllocator::stats() {
+    Central &shared = central();
+    long long allocated;
+    long long requested;
+    {
+        std::lock_guard<std::mutex> lock(shared.registry_mutex);
+        allocated = shared.retired_allocated.load(std::memory_order_relaxed);
+        requested = shared.retired_requested.load(std::memory_order_relaxed);
+        for (const ThreadCache *cache : shared.caches) {
+            allocated += cache->allocated.load(std::memory_order_relaxed);
+            requested += cache->requested.load(std::memory_order_relaxed);
+        }
+    }
+    Stats stats;
+    stats.reserved = shared.reserved.load(std::memory_order_relaxed);
+    stats.allocated = static_cast<std::size_t>(std::max(0LL, allocated));
+    stats.requested = static_cast<std::size_t>(std::max(0LL, requested));
+    return stats;
+}
@@ -0,0 +1,49 @@
+//
+// Hierarchical timing wheel of key deadlines, at millisecond resolution.
+//
+
+#include "timer_wheel.h"
+
+void TimerWheel::insert(std::string_view key, std::uint64_t tick) {
+    key_bytes_ += string_heap_bytes(key.size());
+    place(std::string(key), tick, tick < current_ ? current_ : tick);
+}
+
+void TimerWheel::place(std::string key, std::uint64_t tick, std::uint64_t due) {
+    size_++;
+    for (std::size_t level = 0; level < level_count; level++) {
+        std::size_t shift = level_bits * (level + 1);
+        // Same enclosing block as the current tick: this level's slot for
+        // `due` comes up before the level wraps around
+        if ((due >> shift) == (current_ >> shift)) {
+            levels_[level][(due >> (level_bits * level)) & slot_mask].push_back({std::move(key), tick});
+            return;
+        }
+    }
+    overflow_.push_back({std::move(key), tick});
+}
+
+void TimerWheel::cascade() {
+    // Top down, so entries moved into a slot that is itself due to cascade
+    // at this tick move on down with it
+    if ((current_ & ((std::uint64_t(1) << (level_bits * level_count)) - 1)) == 0 && !overflow_.empty()) {
+        Slot entries = std::move(overflow_);
+        overflow_.clear();
+        size_ -= entries.size();
+        for (auto &entry : entries) {
+            place(std::move(entry.key), entry.tick, entry.tick < current_ ? current_ : entry.tick);
+        }
+    }
+    for (std::size_t level = level_count - 1; level >= 1; level--) {
+        std::size_t shift = level_bits * level;
+        if ((current_ & ((std::uint64_t(1) << shift) - 1)) != 0) {
+            continue; // not at the start of a block of this level
+        }
+        Slot entries = std::move(levels_[level][(current_ >> shift) & slot_mask]);
+        levels_[level][(current_ >> shift) & slot_mask].clear();
+        size_ -= entries.size();
+        for (auto &entry : entries) {
+            place(std::move(entry.key), entry.tick, entry.tick < current_ ? current_ : entry.tick);
+        }
+    }
+}
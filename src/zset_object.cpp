@@ -0,0 +1,216 @@
+//
+// Sorted-set value: a listpack for small zsets, hash plus skiplist beyond.
+//
+
+#include "zset_object.h"
+#include "memory_usage.h"
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <cstdlib>
+
+std::string ZSetObject::format_score(double score) {
+    if (std::isinf(score)) {
+        return score > 0 ? "inf" : "-inf";
+    }
+    char digits[32];
+    auto result = std::to_chars(digits, digits + sizeof(digits), score);
+    return std::string(digits, result.ptr - digits);
+}
+
+bool ZSetObject::parse_score(std::string_view text, double &score) {
+    if (text.empty() || text.size() > 64) {
+        return false;
+    }
+    // strtod needs a terminated buffer and accepts the inf spellings
+    char buffer[65];
+    text.copy(buffer, text.size());
+    buffer[text.size()] = '\0';
+    char *end = nullptr;
+    score = std::strtod(buffer, &end);
+    return end == buffer + text.size() && !std::isnan(score) && !std::isspace(static_cast<unsigned char>(buffer[0]));
+}
+
+double ZSetObject::listpack_score(const ListPack &pack, std::size_t offset) {
+    double score = 0;
+    parse_score(pack.get(offset), score);
+    return score;
+}
+
+const char *ZSetObject::encoding_name() const {
+    return std::holds_alternative<ListPack>(data_) ? "listpack" : "skiplist";
+}
+
+std::size_t ZSetObject::size() const {
+    if (auto *pack = std::get_if<ListPack>(&data_)) {
+        return pack->size() / 2;
+    }
+    return std::get<Sorted>(data_).list.size();
+}
+
+std::size_t ZSetObject::memory_usage() const {
+    if (auto *pack = std::get_if<ListPack>(&data_)) {
+        return pack->bytes();
+    }
+    const auto &sorted = std::get<Sorted>(data_);
+    return sorted.scores.allocated_bytes() + payload_ + sorted.list.memory_usage();
+}
+
+std::size_t ZSetObject::free_effort() const {
+    return std::holds_alternative<ListPack>(data_) ? 1 : size();
+}
+
+std::size_t ZSetObject::listpack_find(std::string_view member) const {
+    return std::get<ListPack>(data_).find(member, 2);
+}
+
+void ZSetObject::listpack_insert(std::string_view member, double score) {
+    auto &pack = std::get<ListPack>(data_);
+    std::size_t offset = pack.first();
+    // Keep pairs ordered by (score, member)
+    while (offset != pack.end()) {
+        std::size_t score_offset = pack.next(offset);
+        double existing = listpack_score(pack, score_offset);
+        if (existing > score || (existing == score && pack.get(offset) > member)) {
+            break;
+        }
+        offset = pack.next(score_offset);
+    }
+    pack.insert(offset, member);
+    pack.insert(pack.next(offset), format_score(score));
+}
+
+bool ZSetObject::add(std::string_view member, double score, const EncodingLimits &limits) {
+    if (auto *pack = std::get_if<ListPack>(&data_)) {
+        std::size_t offset = listpack_find(member);
+        if (offset != pack->end()) {
+            if (listpack_score(*pack, pack->next(offset)) != score) {
+                pack->erase(offset);
+                pack->erase(offset);
+                listpack_insert(member, score);
+            }
+            return false;
+        }
+        if (size() + 1 <= limits.zset_max_listpack_entries && member.size() <= limits.zset_max_listpack_value) {
+            listpack_insert(member, score);
+            return true;
+        }
+        convert_to_sorted();
+    }
+
+    auto &sorted = std::get<Sorted>(data_);
+    auto result = sorted.scores.try_emplace(member, score);
+    if (!result.second) {
+        double &current = result.first->second;
+        if (current != score) {
+            sorted.list.erase(current, member);
+            sorted.list.insert(score, member);
+            current = score;
+        }
+        return false;
+    }
+    sorted.list.insert(score, member);
+    payload_ += string_heap_bytes(member.size());
+    return true;
+}
+
+bool ZSetObject::remove(std::string_view member) {
+    if (auto *pack = std::get_if<ListPack>(&data_)) {
+        std::size_t offset = listpack_find(member);
+        if (offset == pack->end()) {
+            return false;
+        }
+        pack->erase(offset);
+        pack->erase(offset);
+        return true;
+    }
+    auto &sorted = std::get<Sorted>(data_);
+    auto it = sorted.scores.find(member);
+    if (it == sorted.scores.end()) {
+        return false;
+    }
+    sorted.list.erase(it->second, member);
+    sorted.scores.erase(it);
+    payload_ -= string_heap_bytes(member.size());
+    return true;
+}
+
+bool ZSetObject::score(std::string_view member, double &score) const {
+    if (auto *pack = std::get_if<ListPack>(&data_)) {
+        std::size_t offset = listpack_find(member);
+        if (offset == pack->end()) {
+            return false;
+        }
+        score = listpack_score(*pack, pack->next(offset));
+        return true;
+    }
+    const auto &sorted = std::get<Sorted>(data_);
+    auto it = sorted.scores.find(member);
+    if (it == sorted.scores.end()) {
+        return false;
+    }
+    score = it->second;
+    return true;
+}
+
+bool ZSetObject::rank(std::string_view member, std::size_t &rank) const {
+    if (auto *pack = std::get_if<ListPack>(&data_)) {
+        rank = 0;
+        for (std::size_t offset = pack->first(); offset != pack->end(); offset = pack->next(pack->next(offset))) {
+            if (pack->get(offset) == member) {
+                return true;
+            }
+            rank++;
+        }
+        return false;
+    }
+    const auto &sorted = std::get<Sorted>(data_);
+    auto it = sorted.scores.find(member);
+    if (it == sorted.scores.end()) {
+        return false;
+    }
+    rank = sorted.list.rank(it->second, member);
+    return true;
+}
+
+std::pair<std::size_t, std::size_t> ZSetObject::rank_span(const ScoreRange &range) const {
+    if (range.empty()) {
+        return {0, 0};
+    }
+    if (auto *pack = std::get_if<ListPack>(&data_)) {
+        std::size_t first = 0;
+        std::size_t last = 0;
+        for (std::size_t offset = pack->first(); offset != pack->end();) {
+            std::size_t score_offset = pack->next(offset);
+            double score = listpack_score(*pack, score_offset);
+            if (!range.above_min(score)) {
+                first++;
+            }
+            if (range.below_max(score)) {
+                last++;
+            } else {
+                break;
+            }
+            offset = pack->next(score_offset);
+        }
+        return {first, std::max(first, last)};
+    }
+    const auto &list = std::get<Sorted>(data_).list;
+    std::size_t first = list.lower_rank(range);
+    return {first, std::max(first, list.upper_rank(range))};
+}
+
+void ZSetObject::convert_to_sorted() {
+    Sorted sorted;
+    sorted.scores.reserve(size() + 1);
+    std::size_t payload = 0;
+    if (size() > 0) {
+        for_rank_range(0, size() - 1, [&sorted, &payload](std::string_view member, double score) {
+            sorted.scores.try_emplace(member, score);
+            sorted.list.insert(score, member);
+            payload += string_heap_bytes(member.size());
+        });
+    }
+    data_ = std::move(sorted);
+    payload_ = payload;
+}
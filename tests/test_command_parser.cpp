@@ -0,0 +1,208 @@
+//
+// Tests for the RESP / inline request parser and reply serialization.
+//
+
+#include <catch_amalgamated.hpp>
+#include "command_parser.h"
+#include "reply.h"
+#include <string>
+#include <vector>
+
+TEST_CASE("Inline command parsing") {
+    std::vector<std::string_view> tokens;
+
+    SECTION("Whitespace separated tokens") {
+        auto result = parseCommand("SET  foo\tbar\r\nGET foo\r\n", tokens);
+        REQUIRE(result.status == ParseStatus::Complete);
+        REQUIRE(result.protocol == Protocol::Inline);
+        REQUIRE(result.consumed == 14);
+        REQUIRE(tokens.size() == 3);
+        REQUIRE(tokens[0] == "SET");
+        REQUIRE(tokens[2] == "bar");
+    }
+
+    SECTION("Bare newline terminator and empty lines") {
+        auto result = parseCommand("PING\n", tokens);
+        REQUIRE(result.status == ParseStatus::Complete);
+        REQUIRE(tokens.size() == 1);
+
+        result = parseCommand("\r\n", tokens);
+        REQUIRE(result.status == ParseStatus::Complete);
+        REQUIRE(result.consumed == 2);
+        REQUIRE(tokens.empty());
+    }
+
+    SECTION("Partial line") {
+        auto result = parseCommand("GET fo", tokens);
+        REQUIRE(result.status == ParseStatus::Incomplete);
+        REQUIRE(result.consumed == 0);
+    }
+}
+
+TEST_CASE("RESP command parsing") {
+    std::vector<std::string_view> tokens;
+
+    SECTION("Binary safe bulk strings") {
+        std::string frame = "*3\r\n$3\r\nSET\r\n$3\r\nkey\r\n$11\r\nhello world\r\n";
+        auto result = parseCommand(frame, tokens);
+        REQUIRE(result.status == ParseStatus::Complete);
+        REQUIRE(result.protocol == Protocol::Resp);
+        REQUIRE(result.consumed == frame.size());
+        REQUIRE(tokens.size() == 3);
+        REQUIRE(tokens[2] == "hello world");
+
+        std::string binary("*1\r\n$4\r\na\r\0b\r\n", 15);
+        result = parseCommand(binary, tokens);
+        REQUIRE(result.status == ParseStatus::Complete);
+        REQUIRE(tokens[0] == std::string_view("a\r\0b", 4));
+    }
+
+    SECTION("Frames split at every byte boundary") {
+        std::string frame = "*2\r\n$3\r\nGET\r\n$3\r\nfoo\r\n";
+        for (std::size_t i = 0; i < frame.size(); ++i) {
+            auto result = parseCommand(std::string_view(frame).substr(0, i), tokens);
+            REQUIRE(result.status == ParseStatus::Incomplete);
+            REQUIRE(tokens.empty());
+        }
+        REQUIRE(parseCommand(frame, tokens).status == ParseStatus::Complete);
+    }
+
+    SECTION("Pipelined frames are consumed one at a time") {
+        std::string frames = "*1\r\n$4\r\nPING\r\n*1\r\n$4\r\nPING\r\n";
+        auto result = parseCommand(frames, tokens);
+        REQUIRE(result.status == ParseStatus::Complete);
+        REQUIRE(result.consumed == frames.size() / 2);
+    }
+
+    SECTION("Malformed frames") {
+        REQUIRE(parseCommand("*x\r\n", tokens).status == ParseStatus::Error);
+        REQUIRE(parseCommand("*1\r\n+PING\r\n", tokens).status == ParseStatus::Error);
+        REQUIRE(parseCommand("*1\r\n$-5\r\n", tokens).status == ParseStatus::Error);
+        REQUIRE(parseCommand("*1\r\n$4\r\nPINGxx", tokens).status == ParseStatus::Error);
+    }
+}
+
+TEST_CASE("Large last argument received separately") {
+    std::vector<std::string_view> tokens;
+    std::string request = "*3\r\n$3\r\nSET\r\n$1\r\nk\r\n$5\r\nhel";
+
+    auto pending = parseCommand(request, tokens);
+    REQUIRE(pending.status == ParseStatus::Incomplete);
+    REQUIRE(pending.pending_bulk_last);
+    REQUIRE(pending.pending_bulk_length == 5);
+    REQUIRE(request.substr(pending.pending_bulk_offset) == "hel");
+    REQUIRE(tokens.empty());
+
+    // Only the bulk header is in, and an earlier argument is still missing
+    auto early = parseCommand("*3\r\n$3\r\nSET\r\n$1\r\n", tokens);
+    REQUIRE(early.status == ParseStatus::Incomplete);
+    REQUIRE_FALSE(early.pending_bulk_last);
+
+    std::string payload = "hello";
+    std::string head = request.substr(0, pending.pending_bulk_offset);
+    REQUIRE(parseCommandWithLast(head, head.size(), payload, tokens).status == ParseStatus::Incomplete);
+
+    std::string rest = head + "\r\n*1\r\n$4\r\nPING\r\n";
+    auto result = parseCommandWithLast(rest, head.size(), payload, tokens);
+    REQUIRE(result.status == ParseStatus::Complete);
+    REQUIRE(result.consumed == head.size() + 2);
+    REQUIRE(tokens == std::vector<std::string_view>{"SET", "k", "hello"});
+    REQUIRE(tokens.back().data() == payload.data());
+
+    REQUIRE(parseCommandWithLast(head + "xx", head.size(), payload, tokens).status == ParseStatus::Error);
+    REQUIRE(parseCommandWithLast(head + "\r\n", head.size(), "hell", tokens).status == ParseStatus::Error);
+    REQUIRE(tokens.empty());
+}
+
+TEST_CASE("Split requests resume where the previous call stopped") {
+    std::vector<std::string_view> tokens;
+    ParseState state;
+
+    SECTION("Many arguments arriving a byte at a time") {
+        std::string request = "*200\r\n";
+        for (int i = 0; i < 200; ++i) {
+            std::string argument = "arg" + std::to_string(i);
+            request += "$" + std::to_string(argument.size()) + "\r\n" + argument + "\r\n";
+        }
+        request += "*1\r\n$4\r\nPING\r\n";
+        std::size_t length = request.size() - 14;
+
+        for (std::size_t i = 1; i < length; ++i) {
+            // A fresh copy each time: the state must not point into the old one
+            std::string received = request.substr(0, i);
+            REQUIRE(parseCommand(received, tokens, state).status == ParseStatus::Incomplete);
+            REQUIRE(tokens.empty());
+        }
+        REQUIRE(state.arguments.size() == 199);
+
+        auto result = parseCommand(request, tokens, state);
+        REQUIRE(result.status == ParseStatus::Complete);
+        REQUIRE(result.consumed == length);
+        REQUIRE(tokens.size() == 200);
+        REQUIRE(tokens.front() == "arg0");
+        REQUIRE(tokens.back() == "arg199");
+        REQUIRE(state.pos == 0);
+        REQUIRE(state.arguments.empty());
+
+        result = parseCommand(std::string_view(request).substr(length), tokens, state);
+        REQUIRE(result.status == ParseStatus::Complete);
+        REQUIRE(tokens == std::vector<std::string_view>{"PING"});
+    }
+
+    SECTION("Inline line searched once") {
+        REQUIRE(parseCommand("SET foo", tokens, state).status == ParseStatus::Incomplete);
+        REQUIRE(state.pos == 7);
+        REQUIRE(parseCommand("SET foo bar\r\n", tokens, state).status == ParseStatus::Complete);
+        REQUIRE(tokens == std::vector<std::string_view>{"SET", "foo", "bar"});
+        REQUIRE(state.pos == 0);
+    }
+
+    SECTION("Large last argument") {
+        std::string request = "*3\r\n$3\r\nSET\r\n$1\r\nk\r\n$5\r\nhel";
+        REQUIRE(parseCommand(request.substr(0, 16), tokens, state).status == ParseStatus::Incomplete);
+        auto pending = parseCommand(request, tokens, state);
+        REQUIRE(pending.pending_bulk_last);
+        REQUIRE(state.arguments.size() == 2);
+
+        std::string payload = "hello";
+        std::string rest = request.substr(0, pending.pending_bulk_offset) + "\r\n";
+        auto result = parseCommandWithLast(rest, pending.pending_bulk_offset, payload, tokens, state);
+        REQUIRE(result.status == ParseStatus::Complete);
+        REQUIRE(tokens == std::vector<std::string_view>{"SET", "k", "hello"});
+        REQUIRE(state.arguments.empty());
+    }
+
+    SECTION("Errors clear the state") {
+        REQUIRE(parseCommand("*2\r\n$3\r\nGET\r\n", tokens, state).status == ParseStatus::Incomplete);
+        REQUIRE(parseCommand("*2\r\n$3\r\nGET\r\n+foo\r\n", tokens, state).status == ParseStatus::Error);
+        REQUIRE(state.pos == 0);
+        REQUIRE(state.arguments.empty());
+    }
+}
+
+TEST_CASE("Reply serialization") {
+    std::string out;
+
+    SECTION("RESP") {
+        ReplyBuilder reply(out, Protocol::Resp);
+        reply.status("OK");
+        reply.integer(-2);
+        reply.null();
+        reply.array(2);
+        reply.bulk("a");
+        reply.bulk("");
+        REQUIRE(out == "+OK\r\n:-2\r\n$-1\r\n*2\r\n$1\r\na\r\n$0\r\n\r\n");
+    }
+
+    SECTION("Inline") {
+        ReplyBuilder reply(out, Protocol::Inline);
+        reply.status("OK");
+        reply.null();
+        reply.array(3);
+        reply.bulk("a");
+        reply.bulk("b");
+        reply.bulk("c");
+        reply.integer(7);
+        REQUIRE(out == "OK\r\nNULL\r\na b c\r\n7\r\n");
+    }
+}
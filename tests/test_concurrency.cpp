@@ -112,4 +112,67 @@ TEST_CASE("Database concurrent sets and deletes") {
 
     // Test completes successfully if no crashes
     SUCCEED("Concurrent operation completed without crashes");
-}
\ No newline at end of file
+}
+
+TEST_CASE("Database concurrent multi-key operations across stripes") {
+    Database db;
+    std::vector<std::thread> threads;
+    const int num_threads = 8;
+    const int num_keys = 64;
+
+    // Every thread deletes overlapping key sets in a different order; if the
+    // stripe locks were not taken in a fixed order this would deadlock
+    for (int i = 0; i < num_threads; i++) {
+        threads.emplace_back([&db, i]() {
+            for (int j = 0; j < 500; j++) {
+                std::vector<std::string> keys;
+                for (int k = 0; k < 4; k++) {
+                    keys.push_back("multi_" + std::to_string((i * 7 + j * 3 + k * (i + 1)) % num_keys));
+                }
+                db.set(keys[0], "value");
+                db.exists(keys);
+                db.del(keys);
+            }
+        });
+    }
+
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    SUCCEED("Multi-key operations completed without deadlock");
+}
+
+
+TEST_CASE("Database concurrent readers alongside a writer") {
+    Database db;
+    db.set("hot_key", "v0");
+    db.rpush("hot_list", {"a", "b", "c"});
+    std::atomic<bool> stop = false;
+    std::atomic<int> bad_reads = 0;
+
+    std::thread writer([&db, &stop]() {
+        for (int i = 0; i < 2000; i++) {
+            db.set("hot_key", "v" + std::to_string(i));
+        }
+        stop = true;
+    });
+
+    std::vector<std::thread> readers;
+    for (int i = 0; i < 6; i++) {
+        readers.emplace_back([&db, &stop, &bad_reads]() {
+            while (!stop) {
+                if (db.get("hot_key").front() != 'v' || !db.exists("hot_key") ||
+                    db.ttl("hot_key") != -1 || db.lrange("hot_list", 0, -1).size() != 3) {
+                    bad_reads++;
+                }
+            }
+        });
+    }
+
+    writer.join();
+    for (auto& reader : readers) {
+        reader.join();
+    }
+    REQUIRE(bad_reads == 0);
+}
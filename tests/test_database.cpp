@@ -4,6 +4,9 @@
 // #define CATCH_CONFIG_MAIN
 #include <catch_amalgamated.hpp>
 #include "database.h"
+#include <chrono>
+#include <string>
+#include <thread>
 
 TEST_CASE("Database SET and GET") {
     Database db;
@@ -17,3 +20,103 @@ TEST_CASE("Database DEL") {
     REQUIRE(db.del("key") == true);
     REQUIRE(db.get("key") == "NULL");
 }
+
+TEST_CASE("Value layout stays compact") {
+    // A string key pays for its string and a type tag, nothing more
+    REQUIRE(sizeof(Value) <= sizeof(std::string) + sizeof(void *));
+
+    Value list(DataType::LIST);
+    REQUIRE(list.type() == DataType::LIST);
+    REQUIRE(list.list_val().empty());
+}
+
+TEST_CASE("Database SET discards an existing TTL") {
+    Database db;
+    db.set("session", "token");
+    REQUIRE(db.expire("session", 100));
+    REQUIRE(db.ttl("session") > 0);
+
+    db.set("session", "fresh");
+    REQUIRE(db.ttl("session") == -1);
+
+    db.del("session");
+    db.set("session", "again");
+    REQUIRE(db.ttl("session") == -1);
+}
+
+TEST_CASE("Active expiry removes keys nobody touches") {
+    Database db;
+    for (int i = 0; i < 2000; i++) {
+        db.set("session:" + std::to_string(i), "token");
+        if (i % 2 == 0) {
+            db.pexpire("session:" + std::to_string(i), 1);
+        }
+    }
+    db.set("persistent", "value");
+    std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    REQUIRE(db.dbsize() == 2001);
+
+    // The wheels reach every key that came due; a call that runs out of
+    // budget leaves the rest to the next one
+    for (int cycle = 0; cycle < 50 && db.dbsize() > 1001; cycle++) {
+        db.cleanup_expired_keys(std::chrono::milliseconds(25));
+    }
+    REQUIRE(db.dbsize() == 1001);
+    REQUIRE(db.get("session:1") == "token");
+    REQUIRE(db.get("persistent") == "value");
+    REQUIRE(db.ttl("session:1") == -1);
+
+    // Nothing left to expire, so no backlog is reported
+    REQUIRE_FALSE(db.cleanup_expired_keys(std::chrono::microseconds(0)));
+}
+
+TEST_CASE("Reads serialize RESP replies straight from the keyspace") {
+    Database db;
+    std::string out;
+    ReplyBuilder reply(out, Protocol::Resp);
+    auto take = [&out]() {
+        std::string written = out;
+        out.clear();
+        return written;
+    };
+
+    db.set("string", "value");
+    db.get("string", reply);
+    REQUIRE(take() == "$5\r\nvalue\r\n");
+    db.get("missing", reply);
+    REQUIRE(take() == "$-1\r\n");
+
+    db.rpush("list", {"a", "b", "c"});
+    db.lrange("list", 0, -1, reply);
+    REQUIRE(take() == "*3\r\n$1\r\na\r\n$1\r\nb\r\n$1\r\nc\r\n");
+    db.lrange("list", 5, 10, reply);
+    REQUIRE(take() == "*0\r\n");
+    db.lpop("list", reply);
+    db.rpop("list", reply);
+    REQUIRE(take() == "$1\r\na\r\n$1\r\nc\r\n");
+    db.lpop("list", reply);
+    db.lpop("list", reply);
+    REQUIRE(take() == "$1\r\nb\r\n$-1\r\n");
+    REQUIRE_FALSE(db.exists("list"));
+
+    db.hset("hash", "field", "value");
+    db.hget("hash", "field", reply);
+    db.hget("hash", "other", reply);
+    REQUIRE(take() == "$5\r\nvalue\r\n$-1\r\n");
+    db.hmget("hash", {"other", "field"}, reply);
+    REQUIRE(take() == "*2\r\n$-1\r\n$5\r\nvalue\r\n");
+    db.hmget("missing", {"field"}, reply);
+    REQUIRE(take() == "*1\r\n$-1\r\n");
+    db.hgetall("hash", reply);
+    REQUIRE(take() == "*2\r\n$5\r\nfield\r\n$5\r\nvalue\r\n");
+
+    db.sadd("set", {"member"});
+    db.smembers("set", reply);
+    REQUIRE(take() == "*1\r\n$6\r\nmember\r\n");
+
+    // Wrong types read as missing, like the value-returning forms
+    db.get("hash", reply);
+    db.hgetall("string", reply);
+    db.smembers("string", reply);
+    REQUIRE(take() == "$-1\r\n*0\r\n*0\r\n");
+}
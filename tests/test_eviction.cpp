@@ -0,0 +1,162 @@
+//
+// Tests for keyspace memory accounting and maxmemory eviction.
+//
+
+#include <catch_amalgamated.hpp>
+#include "database.h"
+#include <chrono>
+#include <string>
+#include <thread>
+
+namespace {
+
+    std::string key(const char *prefix, int i) {
+        return std::string(prefix) + ":" + std::to_string(i);
+    }
+
+    int surviving(Database &db, const char *prefix, int count) {
+        int alive = 0;
+        for (int i = 0; i < count; i++) {
+            alive += db.exists(key(prefix, i)) ? 1 : 0;
+        }
+        return alive;
+    }
+
+    // Lets the LRU clock move on so earlier accesses look idle
+    void advance_clock(Database &db) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        db.update_clock();
+    }
+
+}
+
+TEST_CASE("Used memory follows writes and deletes") {
+    Database db;
+    REQUIRE(db.used_memory() == 0);
+
+    std::string big(1000, 'x');
+    db.set("big", big);
+    std::size_t with_big = db.used_memory();
+    REQUIRE(with_big >= 1000);
+    REQUIRE(db.del("big"));
+    REQUIRE(db.used_memory() <= with_big - 1000);
+    db.set("big", big);
+    REQUIRE(db.used_memory() == with_big);
+
+    // Containers are charged for what they hold, in every encoding. Tables
+    // keep their slot arrays once grown, so measure with the slots in place.
+    db.rpush("list", {"a"});
+    db.hset("hash", "a", "b");
+    db.sadd("set", {"a"});
+    db.zadd("zset", {{1, "a"}});
+    db.del(std::vector<std::string>{"list", "hash", "set", "zset"});
+    std::size_t before = db.used_memory();
+    for (int i = 0; i < 300; i++) {
+        db.rpush("list", {big.substr(0, 100)});
+        db.hset("hash", key("field", i), big.substr(0, 100));
+        db.sadd("set", {key("member", i)});
+        db.zadd("zset", {{double(i), key("member", i)}});
+    }
+    REQUIRE(db.object_encoding("hash") == "hashtable");
+    REQUIRE(db.object_encoding("zset") == "skiplist");
+    REQUIRE(db.used_memory() >= before + 2 * 300 * 100);
+
+    db.del(std::vector<std::string>{"list", "hash", "set", "zset"});
+    REQUIRE(db.used_memory() == before);
+}
+
+TEST_CASE("Noeviction refuses to free memory") {
+    Database db;
+    db.set("key", "value");
+    db.set_maxmemory(1, EvictionPolicy::NoEviction);
+    REQUIRE_FALSE(db.free_memory_if_needed());
+    REQUIRE(db.get("key") == "value");
+
+    db.set_maxmemory(0, EvictionPolicy::NoEviction);
+    REQUIRE(db.free_memory_if_needed());
+}
+
+TEST_CASE("Eviction policy names") {
+    EvictionPolicy policy;
+    REQUIRE(Database::parse_eviction_policy("allkeys-lfu", policy));
+    REQUIRE(policy == EvictionPolicy::AllKeysLfu);
+    REQUIRE(Database::parse_eviction_policy("volatile-ttl", policy));
+    REQUIRE(policy == EvictionPolicy::VolatileTtl);
+    REQUIRE_FALSE(Database::parse_eviction_policy("allkeys-random", policy));
+}
+
+TEST_CASE("allkeys-lru evicts keys that were not used recently") {
+    Database db;
+    db.set_maxmemory(0, EvictionPolicy::AllKeysLru);
+    std::string payload(100, 'v');
+    for (int i = 0; i < 500; i++) {
+        db.set(key("cold", i), payload);
+        db.set(key("hot", i), payload);
+    }
+    advance_clock(db);
+    for (int i = 0; i < 500; i++) {
+        db.get(key("hot", i));
+    }
+    std::size_t limit = db.used_memory();
+    db.set_maxmemory(limit, EvictionPolicy::AllKeysLru);
+
+    advance_clock(db);
+    for (int i = 0; i < 300; i++) {
+        REQUIRE(db.free_memory_if_needed());
+        db.set(key("new", i), payload);
+    }
+    REQUIRE(db.free_memory_if_needed());
+    REQUIRE(db.used_memory() <= limit);
+    // Sampling is approximate, but idle keys should go first by a wide margin
+    REQUIRE(surviving(db, "cold", 500) <= 200);
+    REQUIRE(surviving(db, "hot", 500) >= 400);
+}
+
+TEST_CASE("allkeys-lfu keeps frequently used keys") {
+    Database db;
+    db.set_maxmemory(0, EvictionPolicy::AllKeysLfu);
+    std::string payload(100, 'v');
+    for (int i = 0; i < 500; i++) {
+        db.set(key("rare", i), payload);
+        db.set(key("frequent", i), payload);
+    }
+    for (int hit = 0; hit < 100; hit++) {
+        for (int i = 0; i < 500; i++) {
+            db.get(key("frequent", i));
+        }
+    }
+    db.set_maxmemory(db.used_memory(), EvictionPolicy::AllKeysLfu);
+
+    for (int i = 0; i < 300; i++) {
+        REQUIRE(db.free_memory_if_needed());
+        db.set(key("new", i), payload);
+    }
+    REQUIRE(surviving(db, "frequent", 500) >= 450);
+}
+
+TEST_CASE("volatile-ttl evicts the nearest deadlines and never persistent keys") {
+    Database db;
+    std::string payload(100, 'v');
+    for (int i = 0; i < 200; i++) {
+        db.set(key("soon", i), payload);
+        db.expire(key("soon", i), 100);
+        db.set(key("later", i), payload);
+        db.expire(key("later", i), 10000);
+        db.set(key("persistent", i), payload);
+    }
+    db.set_maxmemory(db.used_memory(), EvictionPolicy::VolatileTtl);
+
+    for (int i = 0; i < 100; i++) {
+        REQUIRE(db.free_memory_if_needed());
+        db.set(key("new", i), payload);
+    }
+    REQUIRE(surviving(db, "persistent", 200) == 200);
+    REQUIRE(surviving(db, "later", 200) >= 180);
+
+    // Once only keys without a TTL are left, nothing can be evicted
+    db.set_maxmemory(1, EvictionPolicy::VolatileTtl);
+    REQUIRE_FALSE(db.free_memory_if_needed());
+    REQUIRE(surviving(db, "persistent", 200) == 200);
+    REQUIRE(surviving(db, "soon", 200) == 0);
+    REQUIRE(surviving(db, "later", 200) == 0);
+}
@@ -0,0 +1,127 @@
+//
+// Tests for the open-addressing keyspace dictionary.
+//
+
+#include <catch_amalgamated.hpp>
+#include "flat_hash_map.h"
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+TEST_CASE("Flat hash map basic operations") {
+    FlatHashMap<std::string> map;
+    REQUIRE(map.empty());
+    REQUIRE(map.find("missing") == map.end());
+
+    REQUIRE(map.try_emplace("a", "1").second);
+    REQUIRE_FALSE(map.try_emplace("a", "2").second);
+    REQUIRE(map.find(std::string_view("a"))->second == "1");
+
+    map.insert_or_assign("a", std::string("3"));
+    REQUIRE(map["a"] == "3");
+    map["b"] = "4";
+    REQUIRE(map.size() == 2);
+
+    REQUIRE(map.erase("a") == 1);
+    REQUIRE(map.erase("a") == 0);
+    REQUIRE(map.count("a") == 0);
+    REQUIRE(map.count("b") == 1);
+}
+
+TEST_CASE("Flat hash map matches std::unordered_map under churn") {
+    FlatHashMap<int> map;
+    std::unordered_map<std::string, int> reference;
+
+    for (int i = 0; i < 20000; i++) {
+        std::string key = "key:" + std::to_string((i * 7919) % 5000);
+        if (i % 3 == 0) {
+            REQUIRE(map.erase(key) == reference.erase(key));
+        } else {
+            map.insert_or_assign(key, i);
+            reference[key] = i;
+        }
+    }
+
+    REQUIRE(map.size() == reference.size());
+    std::size_t visited = 0;
+    for (const auto &entry : map) {
+        auto it = reference.find(std::string(entry.first));
+        REQUIRE(it != reference.end());
+        REQUIRE(it->second == entry.second);
+        visited++;
+    }
+    REQUIRE(visited == reference.size());
+}
+
+TEST_CASE("Flat hash map holds move-only values and erases while iterating") {
+    FlatHashMap<std::unique_ptr<int>> map;
+    for (int i = 0; i < 100; i++) {
+        map.try_emplace(std::to_string(i), std::make_unique<int>(i));
+    }
+    for (auto it = map.begin(); it != map.end();) {
+        if (*it->second % 2 == 0) {
+            it = map.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    REQUIRE(map.size() == 50);
+    REQUIRE(*map.find("51")->second == 51);
+    REQUIRE(map.find("50") == map.end());
+}
+
+TEST_CASE("Flat hash map rehashes large tables incrementally") {
+    FlatHashMap<int> map;
+    int inserted = 0;
+    // Fill until a growth leaves a migration in progress
+    while (!map.rehashing()) {
+        map.try_emplace("key:" + std::to_string(inserted), inserted);
+        inserted++;
+    }
+
+    // Every entry is still reachable while it lives in either table
+    for (int i = 0; i < inserted; i++) {
+        REQUIRE(map.count("key:" + std::to_string(i)) == 1);
+    }
+    REQUIRE(map.erase("key:0") == 1);
+    std::size_t visited = 0;
+    for (auto it = map.begin(); it != map.end(); ++it) {
+        visited++;
+    }
+    REQUIRE(visited == map.size());
+
+    // Idle steps finish the migration
+    while (map.rehash_step(8)) {
+    }
+    REQUIRE_FALSE(map.rehashing());
+    REQUIRE(map.size() == static_cast<std::size_t>(inserted - 1));
+    REQUIRE(map.find("key:1")->second == 1);
+}
+
+TEST_CASE("Flat hash map scans resume from a cursor") {
+    FlatHashMap<int> map;
+    for (int i = 0; i < 1000; i++) {
+        map.try_emplace(std::to_string(i), i);
+    }
+
+    // Repeated scans from the returned cursor cover every entry once per pass
+    std::unordered_map<int, int> seen;
+    std::size_t cursor = 0;
+    std::size_t visited = 0;
+    while (visited < map.size()) {
+        std::size_t before = visited;
+        cursor = map.scan(cursor, 20, [&](auto it) {
+            seen[it->second]++;
+            visited++;
+        });
+        REQUIRE(visited - before <= 20);
+    }
+    REQUIRE(seen.size() == 1000);
+
+    // Erasing from inside the visitor is allowed
+    cursor = 0;
+    while (!map.empty()) {
+        cursor = map.scan(cursor, 50, [&map](auto it) { map.erase(it); });
+    }
+    REQUIRE(map.scan(cursor, 10, [](auto) { FAIL("empty map visited"); }) == 0);
+}
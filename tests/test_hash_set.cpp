@@ -0,0 +1,151 @@
+//
+// Tests for hash and set values and their compact encodings.
+//
+
+#include <catch_amalgamated.hpp>
+#include "database.h"
+#include <climits>
+#include <string>
+
+TEST_CASE("Hash operations") {
+    Database db;
+
+    REQUIRE(db.hset("h", "f1", "v1"));
+    REQUIRE_FALSE(db.hset("h", "f1", "v2")); // overwrite is not a new field
+    REQUIRE(db.hset("h", "f2", "v3"));
+    REQUIRE(db.hget("h", "f1") == "v2");
+    REQUIRE(db.hget("h", "missing") == "NULL");
+    REQUIRE(db.hgetall("h") == std::unordered_map<std::string, std::string>{{"f1", "v2"}, {"f2", "v3"}});
+
+    REQUIRE(db.hdel("h", "f1"));
+    REQUIRE_FALSE(db.hdel("h", "f1"));
+    REQUIRE(db.hdel("h", "f2"));
+    REQUIRE_FALSE(db.exists("h")); // an emptied hash disappears
+
+    db.set("str", "x");
+    REQUIRE_FALSE(db.hset("str", "f", "v"));
+    REQUIRE(db.hget("str", "f") == "NULL");
+}
+
+TEST_CASE("Set operations") {
+    Database db;
+
+    REQUIRE(db.sadd("s", {"a", "b", "c"}) == 3);
+    REQUIRE(db.sadd("s", {"a", "d"}) == 1);
+    REQUIRE(db.sismember("s", "d"));
+    REQUIRE_FALSE(db.sismember("s", "z"));
+    REQUIRE(db.smembers("s") == std::set<std::string>{"a", "b", "c", "d"});
+
+    REQUIRE(db.srem("s", {"a", "z"}) == 1);
+    REQUIRE(db.srem("s", {"b", "c", "d"}) == 3);
+    REQUIRE_FALSE(db.exists("s"));
+
+    REQUIRE(db.lpush("l", {"x"}) == 1);
+    REQUIRE(db.sadd("l", {"a"}) == 0);
+}
+
+TEST_CASE("Small hashes and sets convert from listpack at the limits") {
+    Database db;
+    EncodingLimits limits;
+    limits.hash_max_listpack_entries = 4;
+    limits.hash_max_listpack_value = 8;
+    limits.set_max_listpack_entries = 4;
+    limits.set_max_listpack_value = 8;
+    db.set_encoding_limits(limits);
+
+    SECTION("Entry count") {
+        for (int i = 0; i < 4; i++) {
+            db.hset("h", "f" + std::to_string(i), "v");
+            db.sadd("s", {"m" + std::to_string(i)});
+        }
+        REQUIRE(db.object_encoding("h") == "listpack");
+        REQUIRE(db.object_encoding("s") == "listpack");
+
+        db.hset("h", "f4", "v");
+        db.sadd("s", {"m4"});
+        REQUIRE(db.object_encoding("h") == "hashtable");
+        REQUIRE(db.object_encoding("s") == "hashtable");
+
+        // Contents survive the conversion
+        REQUIRE(db.hgetall("h").size() == 5);
+        REQUIRE(db.hget("h", "f2") == "v");
+        REQUIRE(db.smembers("s").size() == 5);
+        REQUIRE(db.sismember("s", "m0"));
+    }
+
+    SECTION("Element length") {
+        db.hset("h", "f", "short");
+        db.hset("h", "f", "longer than eight");
+        REQUIRE(db.object_encoding("h") == "hashtable");
+        REQUIRE(db.hget("h", "f") == "longer than eight");
+
+        db.sadd("s", {"longer than eight"});
+        REQUIRE(db.object_encoding("s") == "hashtable");
+    }
+}
+
+TEST_CASE("Object encoding of other types") {
+    Database db;
+    db.set("short", "abc");
+    db.set("long", std::string(100, 'x'));
+    db.rpush("list", {"a"});
+
+    REQUIRE(db.object_encoding("short") == "embstr");
+    REQUIRE(db.object_encoding("long") == "raw");
+    REQUIRE(db.object_encoding("list") == "quicklist");
+    REQUIRE(db.object_encoding("missing").empty());
+}
+
+TEST_CASE("Multi-field hash operations") {
+    Database db;
+
+    REQUIRE(db.hset("h", {{"a", "1"}, {"b", "2"}, {"a", "3"}}) == 2);
+    REQUIRE(db.hmget("h", {"a", "missing", "b"}) == std::vector<std::string>{"3", "NULL", "2"});
+    REQUIRE(db.hmget("nohash", {"a"}) == std::vector<std::string>{"NULL"});
+    REQUIRE(db.hdel("h", std::vector<std::string>{"a", "b", "c"}) == 2);
+    REQUIRE_FALSE(db.exists("h"));
+}
+
+TEST_CASE("HINCRBY") {
+    Database db;
+    long long result = 0;
+
+    REQUIRE(db.hincrby("h", "n", 5, result));
+    REQUIRE(result == 5);
+    REQUIRE(db.hincrby("h", "n", -7, result));
+    REQUIRE(result == -2);
+    REQUIRE(db.hget("h", "n") == "-2");
+
+    db.hset("h", "text", "abc");
+    REQUIRE_FALSE(db.hincrby("h", "text", 1, result));
+    db.hset("h", "big", std::to_string(LLONG_MAX));
+    REQUIRE_FALSE(db.hincrby("h", "big", 1, result));
+    REQUIRE(db.hget("h", "big") == std::to_string(LLONG_MAX));
+
+    db.set("str", "1");
+    REQUIRE_FALSE(db.hincrby("str", "n", 1, result));
+}
+
+TEST_CASE("Large hash and set tables") {
+    Database db;
+    std::set<std::string> members;
+    for (int i = 0; i < 5000; i++) {
+        db.hset("h", "field" + std::to_string(i), std::to_string(i));
+        members.insert("member" + std::to_string(i));
+    }
+    REQUIRE(db.sadd("s", members) == 5000);
+    REQUIRE(db.object_encoding("h") == "hashtable");
+    REQUIRE(db.object_encoding("s") == "hashtable");
+
+    REQUIRE(db.scard("s") == 5000);
+    REQUIRE(db.sismember("s", "member4321"));
+    REQUIRE(db.hget("h", "field4321") == "4321");
+    REQUIRE(db.hgetall("h").size() == 5000);
+    REQUIRE(db.smembers("s") == members);
+
+    for (int i = 0; i < 4999; i++) {
+        db.srem("s", {"member" + std::to_string(i)});
+    }
+    REQUIRE(db.smembers("s") == std::set<std::string>{"member4999"});
+    REQUIRE(db.scard("missing") == 0);
+}
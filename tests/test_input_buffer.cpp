@@ -0,0 +1,69 @@
+//
+// Tests for the cursor-based connection input buffer.
+//
+
+#include <catch_amalgamated.hpp>
+#include "input_buffer.h"
+#include <cstring>
+#include <string>
+
+namespace {
+
+    void append(InputBuffer &buffer, const std::string &bytes) {
+        char *area = buffer.prepare(bytes.size());
+        REQUIRE(buffer.writable() >= bytes.size());
+        std::memcpy(area, bytes.data(), bytes.size());
+        buffer.commit(bytes.size());
+    }
+
+}
+
+TEST_CASE("Input buffer consumes in place") {
+    InputBuffer buffer(64);
+    append(buffer, "PING\r\nPI");
+    const char *before = buffer.data().data();
+    buffer.consume(6);
+    REQUIRE(buffer.data() == "PI");
+    REQUIRE(buffer.data().data() == before + 6);
+
+    // Room is left behind the data, so nothing moves
+    append(buffer, "NG\r\n");
+    REQUIRE(buffer.data() == "PING\r\n");
+    REQUIRE(buffer.data().data() == before + 6);
+
+    // Consuming everything starts over at the front
+    buffer.consume(6);
+    REQUIRE(buffer.empty());
+    REQUIRE(buffer.writable() == 64);
+}
+
+TEST_CASE("Input buffer compacts before growing") {
+    InputBuffer buffer(64);
+    append(buffer, std::string(60, 'a'));
+    buffer.consume(50);
+    append(buffer, std::string(20, 'b'));
+    REQUIRE(buffer.capacity() == 64);
+    REQUIRE(buffer.data() == std::string(10, 'a') + std::string(20, 'b'));
+
+    append(buffer, std::string(100, 'c'));
+    REQUIRE(buffer.capacity() >= 130);
+    REQUIRE(buffer.data() == std::string(10, 'a') + std::string(20, 'b') + std::string(100, 'c'));
+}
+
+TEST_CASE("Input buffer shrinks back once drained") {
+    InputBuffer buffer(64);
+    append(buffer, std::string(1000, 'x'));
+    REQUIRE(buffer.capacity() >= 1000);
+    buffer.consume(999);
+    REQUIRE(buffer.capacity() >= 1000);
+    buffer.consume(1);
+    REQUIRE(buffer.capacity() == 64);
+}
+
+TEST_CASE("Input buffer erases from the middle") {
+    InputBuffer buffer(64);
+    append(buffer, "xx$5\r\nhello\r\n");
+    buffer.consume(2);
+    buffer.erase(4, 5);
+    REQUIRE(buffer.data() == "$5\r\n\r\n");
+}
@@ -0,0 +1,121 @@
+//
+// Tests for the intset encoding and the set conversions around it.
+//
+
+#include <catch_amalgamated.hpp>
+#include "database.h"
+#include "intset.h"
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <random>
+#include <set>
+#include <string>
+#include <vector>
+
+TEST_CASE("Intset parses only canonical integers") {
+    std::int64_t value = 0;
+    REQUIRE(IntSet::parse("0", value));
+    REQUIRE(value == 0);
+    REQUIRE(IntSet::parse("-42", value));
+    REQUIRE(value == -42);
+    REQUIRE(IntSet::parse("-9223372036854775808", value));
+    REQUIRE(value == std::numeric_limits<std::int64_t>::min());
+
+    for (const char *text : {"", "-", "-0", "007", "+1", " 1", "1 ", "1.5", "abc", "9223372036854775808"}) {
+        REQUIRE_FALSE(IntSet::parse(text, value));
+    }
+}
+
+TEST_CASE("Intset keeps members sorted and upgrades its width") {
+    IntSet ints;
+    REQUIRE(ints.insert(5));
+    REQUIRE(ints.insert(-3));
+    REQUIRE_FALSE(ints.insert(5));
+    REQUIRE(ints.width() == 2);
+    REQUIRE(ints.bytes() == 4);
+
+    REQUIRE(ints.insert(100000));
+    REQUIRE(ints.width() == 4);
+    REQUIRE(ints.insert(-5000000000LL));
+    REQUIRE(ints.width() == 8);
+    REQUIRE(ints.size() == 4);
+    REQUIRE(ints.at(0) == -5000000000LL);
+    REQUIRE(ints.at(1) == -3);
+    REQUIRE(ints.at(2) == 5);
+    REQUIRE(ints.at(3) == 100000);
+
+    REQUIRE(ints.contains(-3));
+    REQUIRE_FALSE(ints.contains(4));
+    REQUIRE(ints.erase(-3));
+    REQUIRE_FALSE(ints.erase(-3));
+    REQUIRE(ints.size() == 3);
+}
+
+TEST_CASE("Intset lookups match a reference set at every width") {
+    std::mt19937_64 rng(7);
+    for (std::int64_t range : {std::int64_t(30000), std::int64_t(2000000000), std::int64_t(1) << 62}) {
+        std::uniform_int_distribution<std::int64_t> dist(-range, range);
+        IntSet ints;
+        std::set<std::int64_t> reference;
+        for (int i = 0; i < 3000; i++) {
+            std::int64_t value = dist(rng);
+            REQUIRE(ints.insert(value) == reference.insert(value).second);
+        }
+        REQUIRE(ints.size() == reference.size());
+        REQUIRE(std::is_sorted(reference.begin(), reference.end()));
+        std::size_t index = 0;
+        for (std::int64_t value : reference) {
+            REQUIRE(ints.at(index++) == value);
+        }
+        for (int i = 0; i < 3000; i++) {
+            std::int64_t value = dist(rng);
+            REQUIRE(ints.contains(value) == (reference.count(value) > 0));
+        }
+        for (std::int64_t value : reference) {
+            REQUIRE(ints.contains(value));
+        }
+    }
+}
+
+TEST_CASE("Integer sets use the intset encoding until they cannot") {
+    Database db;
+    EncodingLimits limits;
+    limits.set_max_intset_entries = 8;
+    limits.set_max_listpack_entries = 16;
+    db.set_encoding_limits(limits);
+
+    SECTION("Non-integer member on a small set") {
+        REQUIRE(db.sadd("s", {"1", "2", "300"}) == 3);
+        REQUIRE(db.object_encoding("s") == "intset");
+        REQUIRE(db.sismember("s", "300"));
+        REQUIRE_FALSE(db.sismember("s", "0300"));
+
+        REQUIRE(db.sadd("s", {"x"}) == 1);
+        REQUIRE(db.object_encoding("s") == "listpack");
+        REQUIRE(db.smembers("s") == std::set<std::string>{"1", "2", "300", "x"});
+    }
+
+    SECTION("Too many integers") {
+        for (int i = 0; i < 8; i++) {
+            db.sadd("s", {std::to_string(i * 1000)});
+        }
+        REQUIRE(db.object_encoding("s") == "intset");
+        db.sadd("s", {"-1"});
+        REQUIRE(db.object_encoding("s") == "hashtable");
+        REQUIRE(db.scard("s") == 9);
+        REQUIRE(db.sismember("s", "7000"));
+    }
+
+    SECTION("Non-integer first member") {
+        db.sadd("s", {"a"});
+        REQUIRE(db.object_encoding("s") == "listpack");
+    }
+
+    SECTION("Removing members") {
+        db.sadd("s", {"10", "20"});
+        REQUIRE(db.srem("s", {"10", "abc"}) == 1);
+        REQUIRE(db.srem("s", {"20"}) == 1);
+        REQUIRE_FALSE(db.exists("s"));
+    }
+}
@@ -0,0 +1,102 @@
+//
+// Tests for background reclamation of large values.
+//
+
+#include <catch_amalgamated.hpp>
+#include "database.h"
+#include "lazy_free.h"
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+    // Records which thread destroyed it
+    struct Tracer {
+        explicit Tracer(std::thread::id *destroyed_on) : destroyed_on(destroyed_on) {}
+        Tracer(Tracer &&other) noexcept : destroyed_on(other.destroyed_on) { other.destroyed_on = nullptr; }
+        ~Tracer() {
+            if (destroyed_on != nullptr) {
+                *destroyed_on = std::this_thread::get_id();
+            }
+        }
+        std::thread::id *destroyed_on;
+    };
+
+    std::vector<std::string> elements(int count) {
+        std::vector<std::string> values;
+        for (int i = 0; i < count; i++) {
+            values.push_back("element:" + std::to_string(i));
+        }
+        return values;
+    }
+
+}
+
+TEST_CASE("LazyFree destroys objects on its own thread") {
+    LazyFree reclaimer;
+    std::thread::id destroyed_on;
+    reclaimer.free(Tracer(&destroyed_on));
+    reclaimer.drain();
+    REQUIRE(reclaimer.pending() == 0);
+    REQUIRE(destroyed_on != std::thread::id());
+    REQUIRE(destroyed_on != std::this_thread::get_id());
+}
+
+TEST_CASE("LazyFree finishes its queue when destroyed") {
+    std::thread::id destroyed_on;
+    {
+        LazyFree reclaimer;
+        for (int i = 0; i < 100; i++) {
+            reclaimer.free(std::vector<std::string>(100, std::string(64, 'x')));
+        }
+        reclaimer.free(Tracer(&destroyed_on));
+    }
+    REQUIRE(destroyed_on != std::thread::id());
+}
+
+TEST_CASE("Large values are released in the background") {
+    Database db;
+    db.rpush("big", elements(200000));
+    db.hset("small", "field", "value");
+    std::size_t used = db.used_memory();
+
+    REQUIRE(db.del(std::vector<std::string>{"big", "small"}) == 2);
+    REQUIRE(db.exists("big") == false);
+    REQUIRE(db.used_memory() < used / 2);
+    LazyFree::shared().drain();
+
+    // Overwriting a large value releases it the same way
+    db.sadd("members", std::set<std::string>{"a", "b"});
+    for (const auto &member : elements(1000)) {
+        db.sadd("members", {member});
+    }
+    db.set("members", "now a string");
+    REQUIRE(db.get("members") == "now a string");
+    LazyFree::shared().drain();
+}
+
+TEST_CASE("FLUSHALL removes every key, synchronously or not") {
+    Database db;
+    for (int i = 0; i < 1000; i++) {
+        db.set("key:" + std::to_string(i), "value");
+    }
+    db.rpush("list", elements(1000));
+    db.expire("key:1", 100);
+
+    db.flushall(true);
+    REQUIRE(db.dbsize() == 0);
+    REQUIRE(db.used_memory() == 0);
+    REQUIRE(db.get("key:1") == "NULL");
+    REQUIRE(db.ttl("key:1") == -2);
+
+    // The database stays usable, TTLs included
+    db.set("again", "value");
+    REQUIRE(db.expire("again", 100));
+    REQUIRE(db.ttl("again") > 0);
+    db.flushall(false);
+    REQUIRE(db.dbsize() == 0);
+    LazyFree::shared().drain();
+    REQUIRE(LazyFree::shared().pending() == 0);
+}
@@ -93,6 +93,17 @@ TEST_CASE("Key operations") {
         REQUIRE_FALSE(db.exists("testkey"));
     }
 
+    SECTION("Multi-key DEL and EXISTS") {
+        db.set("k1", "a");
+        db.set("k2", "b");
+        db.rpush("k3", {"c"});
+
+        REQUIRE(db.exists(std::vector<std::string>{"k1", "k2", "k3", "missing"}) == 3);
+        REQUIRE(db.del(std::vector<std::string>{"k1", "k3", "missing"}) == 2);
+        REQUIRE_FALSE(db.exists("k1"));
+        REQUIRE(db.exists("k2"));
+    }
+
     SECTION("EXPIRE and TTL") {
         db.set("expirekey", "temp-value");
 
@@ -127,6 +138,19 @@ TEST_CASE("Key expiration") {
         REQUIRE(db.get("shortlife") == "NULL");
         REQUIRE(db.ttl("shortlife") == -2);
     }
+
+    SECTION("Pushing to an expired key starts a new list") {
+        db.set("was_string", "value");
+        db.pexpire("was_string", 5);
+        db.rpush("was_list", {"old"});
+        db.pexpire("was_list", 5);
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+
+        REQUIRE(db.lpush("was_string", {"a"}) == 1);
+        REQUIRE(db.rpush("was_list", {"new"}) == 1);
+        REQUIRE(db.lrange("was_list", 0, -1) == std::vector<std::string>{"new"});
+        REQUIRE(db.ttl("was_list") == -1);
+    }
 }
 
 TEST_CASE("Type checking and interactions") {
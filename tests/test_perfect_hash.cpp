@@ -0,0 +1,50 @@
+//
+// Tests for the compile-time perfect hash index.
+//
+
+#include <catch_amalgamated.hpp>
+#include "perfect_hash.h"
+#include <set>
+#include <string_view>
+
+namespace {
+
+    struct Entry {
+        std::string_view name;
+        int value;
+    };
+
+    constexpr Entry entries[] = {
+        {"GET", 1}, {"SET", 2}, {"DEL", 3}, {"HGETALL", 4}, {"ZRANGEBYSCORE", 5},
+        {"PING", 6}, {"LPUSH", 7}, {"RPUSH", 8}, {"LPOP", 9}, {"RPOP", 10},
+    };
+
+    constexpr auto entry_index = perfect_hash::build<32>(entries);
+    static_assert(entry_index.valid, "no seed found");
+    // Lookups work at compile time too
+    static_assert(entry_index.find("zrangebyscore", entries) == 4, "folded lookup");
+    static_assert(entry_index.find("GETX", entries) == decltype(entry_index)::npos, "miss");
+
+}
+
+TEST_CASE("Perfect hash finds every name in its own slot") {
+    std::set<std::size_t> slots;
+    for (std::size_t i = 0; i < std::size(entries); i++) {
+        REQUIRE(entry_index.find(entries[i].name, entries) == i);
+        slots.insert(entry_index.slot_of(entries[i].name));
+    }
+    REQUIRE(slots.size() == std::size(entries));
+}
+
+TEST_CASE("Perfect hash lookups ignore ASCII case") {
+    REQUIRE(entry_index.find("get", entries) == 0);
+    REQUIRE(entry_index.find("HGetAll", entries) == 3);
+    REQUIRE(perfect_hash::equals_folded("lPuSh", "LPUSH"));
+    REQUIRE_FALSE(perfect_hash::equals_folded("LPUSH", "RPUSH"));
+}
+
+TEST_CASE("Perfect hash rejects names outside the table") {
+    for (std::string_view name : {"", "GE", "GETT", "SETS", "unknown", "PING "}) {
+        REQUIRE(entry_index.find(name, entries) == decltype(entry_index)::npos);
+    }
+}
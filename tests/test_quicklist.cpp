@@ -0,0 +1,86 @@
+//
+// Tests for the listpack encoding and the quicklist built from it.
+//
+
+#include <catch_amalgamated.hpp>
+#include "listpack.h"
+#include "quicklist.h"
+#include <deque>
+#include <string>
+#include <vector>
+
+TEST_CASE("Listpack walks entries in both directions") {
+    ListPack pack;
+    std::string medium(300, 'm');     // two byte length prefix
+    std::string large(20000, 'L');    // three byte length prefix
+    pack.push_back("a");
+    pack.push_back(medium);
+    pack.push_back("");
+    pack.push_front(large);
+    REQUIRE(pack.size() == 4);
+
+    std::vector<std::string_view> forward;
+    for (std::size_t offset = pack.first(); offset != pack.end(); offset = pack.next(offset)) {
+        forward.push_back(pack.get(offset));
+    }
+    REQUIRE(forward == std::vector<std::string_view>{large, "a", medium, ""});
+
+    std::size_t offset = pack.last();
+    REQUIRE(pack.get(offset).empty());
+    offset = pack.prev(offset);
+    REQUIRE(pack.get(offset) == medium);
+    REQUIRE(pack.prev(pack.prev(offset)) == pack.first());
+
+    pack.replace(pack.find("a"), "b");
+    pack.replace(pack.find(medium), "short");
+    pack.pop_front();
+    pack.pop_back();
+    REQUIRE(pack.size() == 2);
+    REQUIRE(pack.front() == "b");
+    REQUIRE(pack.back() == "short");
+    REQUIRE(pack.find("missing") == pack.end());
+}
+
+TEST_CASE("Quicklist matches a deque across node boundaries") {
+    QuickList list;
+    std::deque<std::string> reference;
+
+    for (int i = 0; i < 5000; i++) {
+        std::string value = "value:" + std::to_string(i) + std::string(i % 50, 'x');
+        if (i % 2 == 0) {
+            list.push_front(value);
+            reference.push_front(value);
+        } else {
+            list.push_back(value);
+            reference.push_back(value);
+        }
+    }
+    // A value larger than a node gets a node of its own
+    std::string huge(QuickList::max_node_bytes * 2, 'h');
+    list.push_back(huge);
+    reference.push_back(huge);
+
+    std::string out;
+    for (int i = 0; i < 1000; i++) {
+        REQUIRE(list.pop_front(out));
+        REQUIRE(out == reference.front());
+        reference.pop_front();
+    }
+    REQUIRE(list.pop_back(out));
+    REQUIRE(out == huge);
+    reference.pop_back();
+    REQUIRE(list.size() == reference.size());
+
+    std::vector<std::string> range;
+    list.for_range(1200, 2300, [&range](std::string_view item) { range.emplace_back(item); });
+    REQUIRE(range.size() == 1101);
+    REQUIRE(range.front() == reference[1200]);
+    REQUIRE(range.back() == reference[2300]);
+
+    while (list.pop_back(out)) {
+        REQUIRE(out == reference.back());
+        reference.pop_back();
+    }
+    REQUIRE(reference.empty());
+    REQUIRE(list.empty());
+}
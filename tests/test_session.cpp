@@ -0,0 +1,100 @@
+//
+// Tests for a client session over a loopback connection.
+//
+
+#include <catch_amalgamated.hpp>
+#include "server.h"
+#include "session.h"
+#include <thread>
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <vector>
+
+TEST_CASE("Written replies release the values spliced into them") {
+    boost::asio::io_context io;
+    tcp::acceptor acceptor(io, tcp::endpoint(boost::asio::ip::address_v4::loopback(), 0));
+    tcp::socket client(io);
+    client.connect(acceptor.local_endpoint());
+    Database db;
+    std::string big(Value::shared_string_min, 'b');
+    db.set("big", big);
+    std::make_shared<Session>(acceptor.accept(), db)->start();
+
+    std::string request = "*2\r\n$3\r\nGET\r\n$3\r\nbig\r\n";
+    boost::asio::write(client, boost::asio::buffer(request));
+    std::string expected = "$" + std::to_string(big.size()) + "\r\n" + big + "\r\n";
+    std::string received(expected.size(), '\0');
+    bool done = false;
+    boost::asio::async_read(client, boost::asio::buffer(received),
+                            [&done](boost::system::error_code, std::size_t) { done = true; });
+    while (!done) {
+        io.run_one();
+    }
+    io.poll();
+    REQUIRE(received == expected);
+
+    // Only the keyspace and this probe hold the buffer once the reply is out
+    std::string out;
+    std::vector<ReplySplice> splices;
+    ReplyBuilder reply(out, Protocol::Resp, &splices);
+    db.get("big", reply);
+    REQUIRE(splices.size() == 1);
+    REQUIRE(splices[0].buffer.use_count() == 2);
+}
+
+TEST_CASE("Pipelined clients on a multi-threaded pool get their replies in order") {
+    boost::asio::io_context io;
+    auto work = boost::asio::make_work_guard(io);
+    Database db;
+    Server server(io, 0, db);
+    std::vector<std::thread> pool;
+    for (int i = 0; i < 4; i++) {
+        pool.emplace_back([&io]() { io.run(); });
+    }
+
+    constexpr int clients = 8;
+    constexpr int rounds = 2000;
+    std::vector<std::thread> threads;
+    std::vector<int> good(clients, 0);
+    for (int c = 0; c < clients; c++) {
+        threads.emplace_back([&, c]() {
+            boost::asio::io_context local;
+            tcp::socket socket(local);
+            socket.connect(tcp::endpoint(boost::asio::ip::address_v4::loopback(), server.port()));
+            // Every round is SET then GET of this client's own key, sent in one batch
+            std::string request;
+            std::string expected;
+            for (int i = 0; i < rounds; i++) {
+                std::string key = "client:" + std::to_string(c);
+                std::string value = std::to_string(i) + std::string(200, 'v');
+                request += "*3\r\n$3\r\nSET\r\n$" + std::to_string(key.size()) + "\r\n" + key + "\r\n$" +
+                           std::to_string(value.size()) + "\r\n" + value + "\r\n";
+                request += "*2\r\n$3\r\nGET\r\n$" + std::to_string(key.size()) + "\r\n" + key + "\r\n";
+                expected += "+OK\r\n$" + std::to_string(value.size()) + "\r\n" + value + "\r\n";
+            }
+            // Written in pieces while the replies are read, so the session's
+            // reads and writes overlap
+            std::thread writer([&socket, &request]() {
+                for (std::size_t offset = 0; offset < request.size(); offset += 4096) {
+                    boost::asio::write(socket, boost::asio::buffer(request.data() + offset,
+                                                                   std::min<std::size_t>(4096, request.size() - offset)));
+                }
+            });
+            std::string received(expected.size(), '\0');
+            boost::system::error_code ec;
+            boost::asio::read(socket, boost::asio::buffer(received), ec);
+            writer.join();
+            good[c] = !ec && received == expected ? 1 : 0;
+        });
+    }
+    for (auto &thread : threads) {
+        thread.join();
+    }
+    work.reset();
+    io.stop();
+    for (auto &thread : pool) {
+        thread.join();
+    }
+    REQUIRE(std::count(good.begin(), good.end(), 1) == clients);
+}
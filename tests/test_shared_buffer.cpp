@@ -0,0 +1,109 @@
+//
+// Tests for shared string buffers and replies that splice them in.
+//
+
+#include <catch_amalgamated.hpp>
+#include "database.h"
+#include "reply.h"
+#include "shared_buffer.h"
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+    // Reassembles what a session would send for `out` and its splices
+    std::string gather(const std::string &out, const std::vector<ReplySplice> &splices) {
+        std::string sent;
+        std::size_t position = 0;
+        for (const auto &splice : splices) {
+            sent.append(out, position, splice.offset - position);
+            sent += splice.buffer.view();
+            position = splice.offset;
+        }
+        sent.append(out, position, std::string::npos);
+        return sent;
+    }
+
+}
+
+TEST_CASE("SharedBuffer handles share one immutable copy") {
+    std::string bytes(100000, 'x');
+    const char *data = bytes.data();
+    SharedBuffer buffer(std::move(bytes));
+    REQUIRE(buffer.data() == data); // moved in, not copied
+    REQUIRE(buffer.size() == 100000);
+    REQUIRE(buffer.use_count() == 1);
+
+    SharedBuffer copy = buffer;
+    REQUIRE(copy.data() == data);
+    REQUIRE(buffer.use_count() == 2);
+    {
+        SharedBuffer moved = std::move(copy);
+        REQUIRE_FALSE(copy);
+        REQUIRE(moved.use_count() == 2);
+    }
+    REQUIRE(buffer.use_count() == 1);
+    REQUIRE(SharedBuffer().size() == 0);
+}
+
+TEST_CASE("SharedBuffer may be released on another thread") {
+    SharedBuffer buffer(std::string(50000, 'y'));
+    std::atomic<int> intact{0};
+    std::vector<std::thread> readers;
+    for (int i = 0; i < 4; i++) {
+        readers.emplace_back([copy = buffer, &intact]() {
+            intact += copy.view() == std::string(50000, 'y') ? 1 : 0;
+        });
+    }
+    buffer = SharedBuffer();
+    for (auto &reader : readers) {
+        reader.join();
+    }
+    REQUIRE(intact == 4);
+}
+
+TEST_CASE("Replies splice shared buffers instead of copying them") {
+    SharedBuffer value(std::string("large value"));
+    std::string out;
+    std::vector<ReplySplice> splices;
+    ReplyBuilder reply(out, Protocol::Resp, &splices);
+    reply.array(2);
+    reply.bulk(value);
+    reply.bulk("small");
+    REQUIRE(splices.size() == 1);
+    REQUIRE(out.find("large value") == std::string::npos);
+    REQUIRE(gather(out, splices) == "*2\r\n$11\r\nlarge value\r\n$5\r\nsmall\r\n");
+
+    // Without a splice list the bytes are copied
+    std::string copied;
+    ReplyBuilder plain(copied, Protocol::Inline);
+    plain.bulk(value);
+    REQUIRE(copied == "large value\r\n");
+}
+
+TEST_CASE("GET pins large values instead of copying them") {
+    Database db;
+    std::string big(Value::shared_string_min, 'b');
+    db.set("big", big);
+    db.set("small", "tiny");
+    REQUIRE(db.object_encoding("big") == "raw");
+    REQUIRE(db.object_encoding("small") == "embstr");
+    REQUIRE(db.get("big") == big);
+
+    std::string out;
+    std::vector<ReplySplice> splices;
+    ReplyBuilder reply(out, Protocol::Resp, &splices);
+    db.get("big", reply);
+    db.get("small", reply);
+    REQUIRE(splices.size() == 1);
+    REQUIRE(out.size() < 32);
+
+    // The pinned bytes outlive an overwrite and a delete of the key
+    std::size_t used = db.used_memory();
+    db.set("big", "replaced");
+    REQUIRE(db.used_memory() < used - big.size());
+    REQUIRE(db.del("big"));
+    REQUIRE(gather(out, splices) == "$" + std::to_string(big.size()) + "\r\n" + big + "\r\n$4\r\ntiny\r\n");
+}
@@ -0,0 +1,125 @@
+//
+// Tests for the size-class slab allocator.
+//
+
+#include <catch_amalgamated.hpp>
+#include "database.h"
+#include "slab_allocator.h"
+#include <cstdint>
+#include <cstring>
+#include <list>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+TEST_CASE("Slab size classes round up and stay aligned") {
+    REQUIRE(SlabAllocator::class_size(1) == 16);
+    REQUIRE(SlabAllocator::class_size(16) == 16);
+    REQUIRE(SlabAllocator::class_size(17) == 32);
+    REQUIRE(SlabAllocator::class_size(129) == 160);
+    REQUIRE(SlabAllocator::class_size(600) == 640);
+    REQUIRE(SlabAllocator::class_size(SlabAllocator::max_size) == SlabAllocator::max_size);
+
+    for (std::size_t size : {1, 8, 24, 100, 200, 500, 1000, 4000}) {
+        void *block = SlabAllocator::allocate(size);
+        REQUIRE(reinterpret_cast<std::uintptr_t>(block) % alignof(std::max_align_t) == 0);
+        std::memset(block, 0xAB, size);
+        SlabAllocator::deallocate(block, size);
+    }
+}
+
+TEST_CASE("Freed slab blocks are reused before new slabs are carved") {
+    std::vector<void *> blocks;
+    for (int i = 0; i < 1000; i++) {
+        blocks.push_back(SlabAllocator::allocate(48));
+    }
+    REQUIRE(std::set<void *>(blocks.begin(), blocks.end()).size() == blocks.size());
+    std::size_t reserved = SlabAllocator::stats().reserved;
+    for (void *block : blocks) {
+        SlabAllocator::deallocate(block, 48);
+    }
+    for (int round = 0; round < 10; round++) {
+        for (auto &block : blocks) {
+            block = SlabAllocator::allocate(48);
+        }
+        for (void *block : blocks) {
+            SlabAllocator::deallocate(block, 48);
+        }
+    }
+    REQUIRE(SlabAllocator::stats().reserved == reserved);
+}
+
+TEST_CASE("Slab stats track requested and allocated bytes") {
+    auto before = SlabAllocator::stats();
+    std::vector<void *> blocks;
+    for (int i = 0; i < 100; i++) {
+        blocks.push_back(SlabAllocator::allocate(40));
+    }
+    auto during = SlabAllocator::stats();
+    REQUIRE(during.requested - before.requested == 100 * 40);
+    REQUIRE(during.allocated - before.allocated == 100 * 48);
+    REQUIRE(during.fragmentation_ratio() >= 1.0);
+
+    for (void *block : blocks) {
+        SlabAllocator::deallocate(block, 40);
+    }
+    auto after = SlabAllocator::stats();
+    REQUIRE(after.requested == before.requested);
+    REQUIRE(after.allocated == before.allocated);
+}
+
+TEST_CASE("Slab blocks may be freed on another thread") {
+    std::vector<void *> blocks;
+    std::thread producer([&blocks]() {
+        for (int i = 0; i < 5000; i++) {
+            blocks.push_back(SlabAllocator::allocate(96));
+        }
+    });
+    producer.join();
+    auto before = SlabAllocator::stats();
+
+    std::thread consumer([&blocks]() {
+        for (void *block : blocks) {
+            SlabAllocator::deallocate(block, 96);
+        }
+    });
+    consumer.join();
+    auto after = SlabAllocator::stats();
+    REQUIRE(before.requested - after.requested == 5000 * 96);
+
+    // The exited consumer's blocks went back to the shared shelves
+    std::size_t reserved = after.reserved;
+    for (auto &block : blocks) {
+        block = SlabAllocator::allocate(96);
+    }
+    REQUIRE(SlabAllocator::stats().reserved == reserved);
+    for (void *block : blocks) {
+        SlabAllocator::deallocate(block, 96);
+    }
+}
+
+TEST_CASE("Node containers can use the slab allocator") {
+    std::list<std::string, SlabStlAllocator<std::string>> strings;
+    for (int i = 0; i < 1000; i++) {
+        strings.push_back(std::to_string(i));
+    }
+    strings.remove_if([](const std::string &value) { return value.size() < 3; });
+    REQUIRE(strings.size() == 900);
+    REQUIRE(strings.front() == "100");
+}
+
+TEST_CASE("Keyspace strings and tables come from the slab") {
+    auto before = SlabAllocator::stats();
+    {
+        Database db;
+        for (int i = 0; i < 1000; i++) {
+            db.set("session:0123456789abcdef:" + std::to_string(i), std::string(100, 'v'));
+            db.hset("hash", "field:0123456789abcdef:" + std::to_string(i), std::string(40, 'v'));
+        }
+        auto during = SlabAllocator::stats();
+        // At least the long keys, fields and values themselves
+        REQUIRE(during.requested - before.requested > 1000 * (25 + 100 + 23 + 40));
+    }
+    REQUIRE(SlabAllocator::stats().requested == before.requested);
+}
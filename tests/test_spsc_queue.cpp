@@ -0,0 +1,53 @@
+//
+// Tests for the lock-free SPSC mailbox used between shards.
+//
+
+#include <catch_amalgamated.hpp>
+#include "spsc_queue.h"
+#include <memory>
+#include <thread>
+
+TEST_CASE("SPSC queue capacity and ordering") {
+    SpscQueue<int> queue(3); // rounded up to 4
+    for (int i = 0; i < 4; i++) {
+        int value = i;
+        REQUIRE(queue.try_push(value));
+    }
+    int overflow = 99;
+    REQUIRE_FALSE(queue.try_push(overflow));
+    REQUIRE(overflow == 99);
+
+    int out = -1;
+    for (int i = 0; i < 4; i++) {
+        REQUIRE(queue.try_pop(out));
+        REQUIRE(out == i);
+    }
+    REQUIRE_FALSE(queue.try_pop(out));
+}
+
+TEST_CASE("SPSC queue hands move-only values across threads") {
+    SpscQueue<std::unique_ptr<int>> queue(64);
+    const int count = 10000;
+
+    std::thread producer([&queue]() {
+        for (int i = 0; i < count; i++) {
+            auto value = std::make_unique<int>(i);
+            while (!queue.try_push(value)) {
+                std::this_thread::yield();
+            }
+        }
+    });
+
+    bool in_order = true;
+    std::unique_ptr<int> value;
+    for (int expected = 0; expected < count;) {
+        if (queue.try_pop(value)) {
+            in_order = in_order && *value == expected;
+            expected++;
+        } else {
+            std::this_thread::yield();
+        }
+    }
+    producer.join();
+    REQUIRE(in_order);
+}
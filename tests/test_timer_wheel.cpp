@@ -0,0 +1,177 @@
+//
+// Tests for the timer wheel and millisecond expiry built on it.
+//
+
+#include <catch_amalgamated.hpp>
+#include "database.h"
+#include "timer_wheel.h"
+#include <chrono>
+#include <cstdint>
+#include <limits>
+#include <map>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+    // Advances the wheel to `now`, collecting what fires
+    std::vector<std::pair<std::string, std::uint64_t>> advance(TimerWheel &wheel, std::uint64_t now) {
+        std::vector<std::pair<std::string, std::uint64_t>> fired;
+        wheel.advance(now, [&fired](std::string_view key, std::uint64_t tick) {
+            fired.emplace_back(std::string(key), tick);
+            return TimerWheel::none;
+        }, []() { return false; });
+        return fired;
+    }
+
+}
+
+TEST_CASE("Timer wheel fires entries at their tick across every level") {
+    const std::uint64_t start = 1000003;
+    TimerWheel wheel(start);
+    std::mt19937_64 rng(5);
+    std::multimap<std::uint64_t, std::string> reference;
+    // Deadlines from this millisecond out past the top level (~4.6 hours)
+    for (std::uint64_t horizon : {std::uint64_t(50), std::uint64_t(5000), std::uint64_t(300000),
+                                  std::uint64_t(20000000), std::uint64_t(40000000)}) {
+        for (int i = 0; i < 40; i++) {
+            std::uint64_t tick = start + rng() % horizon;
+            std::string key = "k" + std::to_string(reference.size());
+            wheel.insert(key, tick);
+            reference.emplace(tick, key);
+        }
+    }
+    REQUIRE(wheel.size() == reference.size());
+
+    // Step in uneven strides; every entry must fire exactly when reached
+    std::uint64_t now = start;
+    while (!reference.empty()) {
+        now += 1 + rng() % 40000;
+        for (const auto &fired : advance(wheel, now)) {
+            auto it = reference.find(fired.second);
+            REQUIRE(it != reference.end());
+            REQUIRE(fired.second <= now);
+            reference.erase(it);
+        }
+        REQUIRE(wheel.size() == reference.size());
+        REQUIRE((reference.empty() || reference.begin()->first > now));
+    }
+}
+
+TEST_CASE("Timer wheel retries and stops on request") {
+    TimerWheel wheel(100);
+    wheel.insert("past", 10); // already due
+    wheel.insert("a", 105);
+    wheel.insert("b", 105);
+
+    REQUIRE(advance(wheel, 100).size() == 1);
+
+    int attempts = 0;
+    bool finished = wheel.advance(105, [&attempts](std::string_view, std::uint64_t tick) {
+        return ++attempts == 1 ? tick : TimerWheel::none; // ask for one retry
+    }, [&attempts]() { return attempts == 1; });
+    REQUIRE_FALSE(finished);
+    REQUIRE(wheel.size() == 1 + 1); // one left in the slot, one retrying
+
+    REQUIRE(advance(wheel, 106).size() == 2);
+    REQUIRE(wheel.size() == 0);
+    REQUIRE(wheel.memory_usage() == 0);
+}
+
+TEST_CASE("Timer wheel entries can move on to a later tick") {
+    TimerWheel wheel(100);
+    wheel.insert("a key longer than the inline buffer", 110);
+    REQUIRE(wheel.memory_usage() > 0);
+
+    std::vector<std::uint64_t> fired;
+    auto follow = [&fired](std::string_view, std::uint64_t tick) {
+        fired.push_back(tick);
+        return tick == 110 ? std::uint64_t(50000) : TimerWheel::none;
+    };
+    auto never = []() { return false; };
+    wheel.advance(49999, follow, never);
+    REQUIRE(fired == std::vector<std::uint64_t>{110});
+    REQUIRE(wheel.size() == 1);
+    wheel.advance(50000, follow, never);
+    REQUIRE(fired == std::vector<std::uint64_t>{110, 50000});
+    REQUIRE(wheel.size() == 0);
+    REQUIRE(wheel.memory_usage() == 0);
+}
+
+TEST_CASE("Millisecond expiry") {
+    Database db;
+    db.set("k", "v");
+
+    REQUIRE(db.pexpire("k", 50000));
+    long long remaining = db.pttl("k");
+    REQUIRE(remaining > 49000);
+    REQUIRE(remaining <= 50000);
+    REQUIRE(db.ttl("k") == 50);
+
+    auto unix_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+    REQUIRE(db.pexpireat("k", unix_ms + 20000));
+    REQUIRE(db.ttl("k") == 20);
+    REQUIRE_FALSE(db.pexpire("missing", 10));
+    REQUIRE(db.pttl("missing") == -2);
+
+    // Expired keys disappear through the wheel without being touched
+    db.pexpire("k", 5);
+    db.set("other", "v");
+    db.pexpire("other", 100000);
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    REQUIRE(db.dbsize() == 2);
+    REQUIRE_FALSE(db.cleanup_expired_keys(std::chrono::milliseconds(25)));
+    REQUIRE(db.dbsize() == 1);
+    REQUIRE(db.ttl("other") == 100);
+
+    // A TTL removed by SET leaves a stale wheel entry that must not fire
+    db.set("renewed", "v");
+    db.pexpire("renewed", 5);
+    db.set("renewed", "v2");
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    db.cleanup_expired_keys(std::chrono::milliseconds(25));
+    REQUIRE(db.get("renewed") == "v2");
+}
+
+TEST_CASE("Extending a TTL reuses the key's wheel entry") {
+    Database db;
+    db.set("session:0123456789abcdef", "v");
+    db.pexpire("session:0123456789abcdef", 1000000);
+    std::size_t used = db.used_memory();
+    for (int i = 0; i < 1000; i++) {
+        REQUIRE(db.pexpire("session:0123456789abcdef", 1000000 + i));
+        db.set("session:0123456789abcdef", "v"); // SET drops the TTL, not the entry
+        REQUIRE(db.pexpire("session:0123456789abcdef", 2000000 + i));
+    }
+    REQUIRE(db.used_memory() == used);
+
+    // The entry fires at the old deadline and follows the key to the new one
+    REQUIRE(db.pexpire("session:0123456789abcdef", 5));
+    REQUIRE(db.pexpire("session:0123456789abcdef", 30));
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    db.cleanup_expired_keys(std::chrono::milliseconds(25));
+    REQUIRE(db.exists("session:0123456789abcdef"));
+    std::this_thread::sleep_for(std::chrono::milliseconds(30));
+    db.cleanup_expired_keys(std::chrono::milliseconds(25));
+    REQUIRE(db.dbsize() == 0);
+}
+
+TEST_CASE("Deadlines that are due or out of range") {
+    Database db;
+    db.set("k", "v");
+    REQUIRE_FALSE(Database::ttl_fits(std::numeric_limits<long long>::max()));
+    REQUIRE(Database::ttl_fits(-5));
+    REQUIRE_FALSE(db.pexpire("k", std::numeric_limits<long long>::max()));
+    REQUIRE(db.pttl("k") == -1);
+
+    // Zero, negative and past deadlines delete the key right away
+    REQUIRE(db.pexpire("k", -1));
+    REQUIRE(db.dbsize() == 0);
+    db.set("k", "v");
+    REQUIRE(db.pexpireat("k", 1000));
+    REQUIRE(db.dbsize() == 0);
+    REQUIRE_FALSE(db.pexpire("k", 0));
+}
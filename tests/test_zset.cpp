@@ -0,0 +1,139 @@
+//
+// Tests for sorted sets: the skiplist, both encodings and the range replies.
+//
+
+#include <catch_amalgamated.hpp>
+#include "database.h"
+#include "skiplist.h"
+#include <algorithm>
+#include <random>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace {
+
+    std::string zrange(Database &db, const std::string &key, long long start, long long stop, bool with_scores) {
+        std::string out;
+        ReplyBuilder reply(out, Protocol::Inline);
+        db.zrange(key, start, stop, with_scores, reply);
+        return out;
+    }
+
+    std::string zrangebyscore(Database &db, const std::string &key, const ScoreRange &range,
+                              long long offset = 0, long long count = -1) {
+        std::string out;
+        ReplyBuilder reply(out, Protocol::Inline);
+        db.zrangebyscore(key, range, false, offset, count, reply);
+        return out;
+    }
+
+}
+
+TEST_CASE("Skiplist ranks agree with an ordered reference") {
+    SkipList list;
+    std::set<std::pair<double, std::string>> reference;
+    std::mt19937 rng(11);
+    std::uniform_int_distribution<int> scores(0, 200);
+
+    for (int i = 0; i < 4000; i++) {
+        std::string member = "m" + std::to_string(rng() % 1500);
+        double score = scores(rng);
+        auto existing = std::find_if(reference.begin(), reference.end(),
+                                     [&member](const auto &entry) { return entry.second == member; });
+        if (existing != reference.end()) {
+            REQUIRE(list.erase(existing->first, member));
+            reference.erase(existing);
+        } else {
+            list.insert(score, member);
+            reference.emplace(score, member);
+        }
+    }
+    REQUIRE(list.size() == reference.size());
+
+    std::size_t rank = 0;
+    for (const auto &entry : reference) {
+        REQUIRE(list.rank(entry.first, entry.second) == rank);
+        const SkipList::Node *node = list.at_rank(rank);
+        REQUIRE(node != nullptr);
+        REQUIRE(std::string_view(node->member()) == entry.second);
+        rank++;
+    }
+    REQUIRE(list.at_rank(rank) == nullptr);
+
+    ScoreRange range{50, 100, true, false};
+    std::size_t below = 0, within = 0;
+    for (const auto &entry : reference) {
+        below += range.above_min(entry.first) ? 0 : 1;
+        within += range.contains(entry.first) ? 1 : 0;
+    }
+    REQUIRE(list.lower_rank(range) == below);
+    REQUIRE(list.upper_rank(range) == below + within);
+}
+
+TEST_CASE("Sorted set operations") {
+    Database db;
+    EncodingLimits limits;
+    limits.zset_max_listpack_entries = 4;
+    db.set_encoding_limits(limits);
+
+    // Run every check against both encodings
+    std::size_t filler = GENERATE(0, 10);
+    for (std::size_t i = 0; i < filler; i++) {
+        db.zadd("z", {{1000.0 + i, "zz" + std::to_string(i)}});
+    }
+    const char *encoding = filler == 0 ? "listpack" : "skiplist";
+
+    REQUIRE(db.zadd("z", {{2, "b"}, {1, "a"}, {3, "c"}}) == 3);
+    REQUIRE(db.zadd("z", {{1.5, "c"}}) == 0); // update moves c between a and b
+    REQUIRE(db.object_encoding("z") == encoding);
+    REQUIRE(db.zcard("z") == static_cast<long long>(3 + filler));
+
+    double score = 0;
+    REQUIRE(db.zscore("z", "c", score));
+    REQUIRE(score == 1.5);
+    REQUIRE_FALSE(db.zscore("z", "missing", score));
+
+    long long rank = -1;
+    REQUIRE(db.zrank("z", "b", rank));
+    REQUIRE(rank == 2);
+    REQUIRE_FALSE(db.zrank("z", "missing", rank));
+
+    REQUIRE(zrange(db, "z", 0, 2, false) == "a c b\r\n");
+    REQUIRE(zrange(db, "z", 0, 1, true) == "a 1 c 1.5\r\n");
+    REQUIRE(zrange(db, "z", 5, 2, false) == "\r\n");
+    REQUIRE(zrange(db, "missing", 0, -1, false) == "\r\n");
+
+    REQUIRE(zrangebyscore(db, "z", {1, 2, false, false}) == "a c b\r\n");
+    REQUIRE(zrangebyscore(db, "z", {1, 2, true, true}) == "c\r\n");
+    REQUIRE(zrangebyscore(db, "z", {1, 2, false, false}, 1, 1) == "c\r\n");
+    REQUIRE(zrangebyscore(db, "z", {5, 9, false, false}) == "\r\n");
+
+    REQUIRE(db.zrem("z", {"a", "missing"}) == 1);
+    REQUIRE(zrange(db, "z", 0, 0, false) == "c\r\n");
+}
+
+TEST_CASE("Sorted set conversion and type checks") {
+    Database db;
+    for (int i = 0; i < 200; i++) {
+        db.zadd("z", {{static_cast<double>(200 - i), "m" + std::to_string(i)}});
+    }
+    REQUIRE(db.object_encoding("z") == "skiplist");
+    REQUIRE(zrange(db, "z", -2, -1, true) == "m1 199 m0 200\r\n");
+
+    db.zadd("long", {{1, std::string(100, 'x')}});
+    REQUIRE(db.object_encoding("long") == "skiplist");
+
+    db.set("str", "v");
+    REQUIRE(db.zadd("str", {{1, "a"}}) == 0);
+    REQUIRE(db.zcard("str") == 0);
+
+    double score;
+    REQUIRE(ZSetObject::parse_score("-inf", score));
+    REQUIRE(ZSetObject::parse_score("2.5e3", score));
+    REQUIRE(score == 2500);
+    REQUIRE_FALSE(ZSetObject::parse_score("nan", score));
+    REQUIRE_FALSE(ZSetObject::parse_score("1x", score));
+    REQUIRE(ZSetObject::format_score(0.1) == "0.1");
+}